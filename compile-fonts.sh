@@ -1 +1,2 @@
 ./node_modules/.bin/fctx-compiler resources.svg
+python tools/digit-atlas.py resources.svg resources/data
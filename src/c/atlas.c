@@ -0,0 +1,153 @@
+
+#include "atlas.h"
+
+#define ATLAS_VERSION 1
+
+typedef struct __attribute__((packed)) {
+    uint8_t code;
+    uint8_t width;
+    int8_t left;
+    uint8_t reserved;
+    uint16_t advance;
+    uint16_t offset;
+} AtlasGlyph;
+
+/* The atlas is the resource loaded as is; this header is at its start
+   and the glyph offsets are relative to it. */
+struct __attribute__((packed)) DigitAtlas {
+    uint8_t version;
+    uint8_t capHeight;
+    uint8_t cellHeight;
+    uint8_t baseline;
+    uint8_t glyphCount;
+    AtlasGlyph glyphs[];
+};
+
+DigitAtlas* digit_atlas_create_from_resource(uint32_t resource_id) {
+    ResHandle handle = resource_get_handle(resource_id);
+    size_t size = resource_size(handle);
+    if (size < sizeof(DigitAtlas)) {
+        return NULL;
+    }
+    DigitAtlas* atlas = malloc(size);
+    if (atlas) {
+        resource_load(handle, (uint8_t*)atlas, size);
+        if (atlas->version != ATLAS_VERSION
+            || size < sizeof(DigitAtlas) + atlas->glyphCount * sizeof(AtlasGlyph)) {
+            free(atlas);
+            atlas = NULL;
+        }
+    }
+    return atlas;
+}
+
+void digit_atlas_destroy(DigitAtlas* atlas) {
+    free(atlas);
+}
+
+int16_t digit_atlas_get_cap_height(const DigitAtlas* atlas) {
+    return atlas->capHeight;
+}
+
+static const AtlasGlyph* findGlyph(const DigitAtlas* atlas, char code) {
+    for (int k = 0; k < atlas->glyphCount; ++k) {
+        if (atlas->glyphs[k].code == (uint8_t)code) {
+            return &atlas->glyphs[k];
+        }
+    }
+    return NULL;
+}
+
+#if defined(PBL_COLOR)
+static inline uint8_t blendChannel(uint8_t dst, uint8_t src, uint8_t alpha) {
+    return (src * alpha + dst * (3 - alpha) + 1) / 3;
+}
+#endif
+
+/* Composite one glyph cell into the framebuffer, with its top left
+   corner at (x0, y0). */
+static void blitGlyph(const DigitAtlas* atlas, const AtlasGlyph* glyph,
+                      GBitmap* fb, int16_t x0, int16_t y0, GColor color) {
+    GRect bounds = gbitmap_get_bounds(fb);
+    const uint8_t* cell = (const uint8_t*)atlas + glyph->offset;
+    int16_t rowBytes = (glyph->width + 3) / 4;
+#if defined(PBL_BW)
+    uint8_t* data = gbitmap_get_data(fb);
+    uint16_t stride = gbitmap_get_bytes_per_row(fb);
+    bool white = gcolor_equal(color, GColorWhite);
+    bool gray = !white && !gcolor_equal(color, GColorBlack);
+#endif
+
+    for (int16_t r = 0; r < atlas->cellHeight; ++r, cell += rowBytes) {
+        int16_t y = y0 + r;
+        if (y < 0 || y >= bounds.size.h) {
+            continue;
+        }
+#if defined(PBL_BW)
+        uint8_t* row = data + y * stride;
+        int16_t minX = 0;
+        int16_t maxX = bounds.size.w - 1;
+#else
+        GBitmapDataRowInfo info = gbitmap_get_data_row_info(fb, y);
+        uint8_t* row = info.data;
+        int16_t minX = info.min_x;
+        int16_t maxX = info.max_x;
+#endif
+        for (int16_t c = 0; c < glyph->width; ++c) {
+            uint8_t alpha = (cell[c / 4] >> ((c % 4) * 2)) & 3;
+            int16_t x = x0 + c;
+            if (alpha == 0 || x < minX || x > maxX) {
+                continue;
+            }
+#if defined(PBL_BW)
+            /* No blending in 1-bit, so take the pixels that are mostly
+               covered.  Gray is dithered the same way the system does. */
+            if (alpha >= 2) {
+                bool set = gray ? ((x + y) & 1) : white;
+                uint8_t mask = 1 << (x % 8);
+                row[x / 8] = set ? (row[x / 8] | mask) : (row[x / 8] & ~mask);
+            }
+#else
+            GColor8 dst = (GColor8) { .argb = row[x] };
+            dst.r = blendChannel(dst.r, color.r, alpha);
+            dst.g = blendChannel(dst.g, color.g, alpha);
+            dst.b = blendChannel(dst.b, color.b, alpha);
+            row[x] = dst.argb;
+#endif
+        }
+    }
+}
+
+bool digit_atlas_draw_string(const DigitAtlas* atlas, GContext* ctx, const char* text,
+                             FPoint offset, GTextAlignment alignment, GColor color) {
+
+    /* Measure first, so that nothing is drawn for unsupported text. */
+    fixed_t width = 0;
+    for (const char* c = text; *c; ++c) {
+        const AtlasGlyph* glyph = findGlyph(atlas, *c);
+        if (!glyph) {
+            return false;
+        }
+        width += glyph->advance;
+    }
+
+    fixed_t pen = offset.x;
+    if (alignment == GTextAlignmentCenter) {
+        pen -= width / 2;
+    } else if (alignment == GTextAlignmentRight) {
+        pen -= width;
+    }
+    int16_t top = FIXED_TO_INT(offset.y + FIX1 / 2) - atlas->baseline;
+
+    GBitmap* fb = graphics_capture_frame_buffer(ctx);
+    if (!fb) {
+        return false;
+    }
+    for (const char* c = text; *c; ++c) {
+        const AtlasGlyph* glyph = findGlyph(atlas, *c);
+        blitGlyph(atlas, glyph, fb, FIXED_TO_INT(pen + FIX1 / 2) + glyph->left, top, color);
+        pen += glyph->advance;
+    }
+    graphics_release_frame_buffer(ctx, fb);
+    return true;
+}
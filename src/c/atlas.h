@@ -0,0 +1,20 @@
+#pragma once
+#include <pebble.h>
+#include <pebble-fctx/fctx.h>
+
+/* A digit atlas holds glyphs that were rasterized at build time (see
+   tools/digit-atlas.py) as 2-bit coverage masks, so that a string of
+   them can be blitted instead of scan converted from outlines. */
+typedef struct DigitAtlas DigitAtlas;
+
+DigitAtlas* digit_atlas_create_from_resource(uint32_t resource_id);
+void digit_atlas_destroy(DigitAtlas* atlas);
+
+/* The cap height, in pixels, that the glyphs were rasterized at. */
+int16_t digit_atlas_get_cap_height(const DigitAtlas* atlas);
+
+/* Draw the text with its baseline at the offset, tinted with the color.
+   Nothing is drawn, and false is returned, if the text contains any
+   character that is not in the atlas. */
+bool digit_atlas_draw_string(const DigitAtlas* atlas, GContext* ctx, const char* text,
+                             FPoint offset, GTextAlignment alignment, GColor color);
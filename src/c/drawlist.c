@@ -0,0 +1,83 @@
+
+#include "drawlist.h"
+
+static inline bool overlaps(const GRect* a, const GRect* b) {
+    return a->origin.x < b->origin.x + b->size.w && b->origin.x < a->origin.x + a->size.w
+        && a->origin.y < b->origin.y + b->size.h && b->origin.y < a->origin.y + a->size.h;
+}
+
+void draw_list_init(DrawList* list) {
+    list->count = 0;
+    list->passesRecorded = 0;
+    list->passesDrawn = 0;
+}
+
+void draw_list_add_path(DrawList* list, DrawListPlot plot, int32_t arg, GColor color, GRect bounds) {
+    if (list->count < DRAW_LIST_CAPACITY) {
+        list->items[list->count++] = (DrawListItem) {
+            .plot = plot,
+            .arg = arg,
+            .color = color,
+            .bounds = bounds,
+        };
+    }
+}
+
+void draw_list_add_rect(DrawList* list, GRect rect, GColor color) {
+    draw_list_add_path(list, NULL, 0, color, rect);
+}
+
+/* Can the item at j be drawn in the pass that starts with the item at i,
+   ahead of everything still pending in between? */
+static bool canJoin(const DrawList* list, const bool* drawn, const bool* pass, int i, int j) {
+    const DrawListItem* item = &list->items[j];
+    for (int k = i; k < j; ++k) {
+        if ((pass[k] || !drawn[k]) && overlaps(&item->bounds, &list->items[k].bounds)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void draw_list_flush(DrawList* list, FContext* fctx) {
+
+    bool drawn[DRAW_LIST_CAPACITY] = { false };
+    bool pass[DRAW_LIST_CAPACITY];
+
+    for (int i = 0; i < list->count; ++i) {
+        if (drawn[i]) {
+            continue;
+        }
+        DrawListItem* first = &list->items[i];
+        drawn[i] = true;
+
+        if (!first->plot) {
+            graphics_context_set_fill_color(fctx->gctx, first->color);
+            graphics_fill_rect(fctx->gctx, first->bounds, 0, GCornerNone);
+            continue;
+        }
+
+        memset(pass, 0, sizeof(pass));
+        pass[i] = true;
+        ++list->passesRecorded;
+        ++list->passesDrawn;
+        fctx_begin_fill(fctx);
+        fctx_set_fill_color(fctx, first->color);
+        first->plot(fctx, first->arg);
+
+        for (int j = i + 1; j < list->count; ++j) {
+            DrawListItem* item = &list->items[j];
+            if (drawn[j] || !item->plot || !gcolor_equal(item->color, first->color)
+                || !canJoin(list, drawn, pass, i, j)) {
+                continue;
+            }
+            item->plot(fctx, item->arg);
+            drawn[j] = pass[j] = true;
+            ++list->passesRecorded;
+        }
+
+        fctx_end_fill(fctx);
+    }
+
+    list->count = 0;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <pebble.h>
+#include <pebble-fctx/fctx.h>
+
+#define DRAW_LIST_CAPACITY 8
+
+/* Plots one path into the current fctx fill, given the argument it was
+   recorded with.  It sets whatever transform it needs. */
+typedef void (*DrawListPlot)(FContext* fctx, int32_t arg);
+
+typedef struct {
+    DrawListPlot plot;   // NULL for a rectangle drawn by the system
+    int32_t arg;
+    GColor color;
+    GRect bounds;
+} DrawListItem;
+
+/* A draw list records filled paths in painting order, each with its color
+   and bounds, and then draws them with as few fctx fill passes as it can.
+   A path joins an earlier pass of the same color if it overlaps nothing
+   already in that pass (a pass fills even-odd) and nothing painted in
+   between.  Rectangles are drawn by the system, in order. */
+typedef struct {
+    DrawListItem items[DRAW_LIST_CAPACITY];
+    uint8_t count;
+    uint16_t passesRecorded;
+    uint16_t passesDrawn;
+} DrawList;
+
+void draw_list_init(DrawList* list);
+void draw_list_add_path(DrawList* list, DrawListPlot plot, int32_t arg, GColor color, GRect bounds);
+void draw_list_add_rect(DrawList* list, GRect rect, GColor color);
+void draw_list_flush(DrawList* list, FContext* fctx);
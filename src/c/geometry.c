@@ -0,0 +1,36 @@
+#include "geometry.h"
+
+FPoint clock_point(FPoint center, fixed_t radius, int32_t angle) {
+    FPoint pt;
+    int32_t c = cos_lookup(angle);
+    int32_t s = sin_lookup(angle);
+    pt.x = center.x - s * radius / TRIG_MAX_RATIO;
+    pt.y = center.y + c * radius / TRIG_MAX_RATIO;
+    return pt;
+}
+
+void clock_points(FPoint center, fixed_t radius, const int32_t units[][2], int count,
+                  Rotation rotation, FPoint* points) {
+    for (int k = 0; k < count; ++k) {
+        fixed_t x = units[k][0] * radius / TRIG_MAX_RATIO;
+        fixed_t y = units[k][1] * radius / TRIG_MAX_RATIO;
+        points[k].x = center.x + (x * rotation.cos - y * rotation.sin) / TRIG_MAX_RATIO;
+        points[k].y = center.y + (y * rotation.cos + x * rotation.sin) / TRIG_MAX_RATIO;
+    }
+}
+
+int16_t chord_midpoint_row(fixed_t radius, int32_t angle0, int32_t angle1) {
+    FPoint p0 = clock_point(FPointZero, radius, angle0);
+    FPoint p1 = clock_point(FPointZero, radius, angle1);
+    /* Shift rather than divide, so that rows above the center round to
+       nearest too, instead of toward zero. */
+    return (p0.y + p1.y + FIX1) >> (FIXED_POINT_SHIFT + 1);
+}
+
+void arc_chords(int32_t r, int count, fixed_t* chords) {
+    for (int k = 0; k < count; ++k) {
+        /* r * r - (r - k) * (r - k), which stays small near the edge. */
+        uint32_t q = usqrt(k * (2 * r - k));
+        chords[k] = q / (SQRT_SCALE / FIXED_POINT_SCALE);
+    }
+}
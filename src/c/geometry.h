@@ -0,0 +1,71 @@
+#pragma once
+#include <pebble.h>
+#include <pebble-fctx/fctx.h>
+#include "isqrt.h"
+
+/* Fixed point geometry of the clock face.  Points and radii are fctx
+   fixed_t, in 1/16 pixel.  Angles are in TRIG_MAX_ANGLE units, measured
+   clockwise from midnight at the bottom of the dial.  Sines and cosines
+   come from the system tables, scaled by TRIG_MAX_RATIO, so each one is
+   good to about 1/65536. */
+
+/* Cosine and sine of a rotation, looked up once and reused. */
+typedef struct {
+    int32_t cos;
+    int32_t sin;
+} Rotation;
+
+static inline Rotation rotation_from_angle(int32_t angle) {
+    return (Rotation) {
+        .cos = cos_lookup(angle),
+        .sin = sin_lookup(angle),
+    };
+}
+
+/* Convert hours to angle.  Exact for whole hours of any day. */
+static inline int32_t hour_angle(int32_t hour) {
+    return hour * TRIG_MAX_ANGLE / 24;
+}
+
+/* Convert minutes to angle.  Rounds toward zero, by less than 1/24 of a
+   minute; the product overflows beyond 32767 minutes either way. */
+static inline int32_t minute_angle(int32_t minute) {
+    return minute * TRIG_MAX_ANGLE / (24*60);
+}
+
+/* Half the width of the chord at height dy through a circle of radius
+   r, rounded down, or -1 if the circle does not reach that far.  Any
+   units, as long as r * r fits in 32 bits, so below 46341, which is
+   about 2896 pixels in fixed point. */
+static inline int32_t circle_chord(int32_t r, int32_t dy) {
+    if (r <= 0 || r * r <= dy * dy) {
+        return -1;
+    }
+    return usqrt(r * r - dy * dy) >> SQRT_SHIFT;
+}
+
+/* Half the widths of the chords through a circle of radius r, in whole
+   pixels, at the first count rows in from its edge: row k is k pixels in
+   from the tangent.  In fixed point, rounded down, and exact for radii
+   below 8192 pixels.  The battery dish follows this arc. */
+void arc_chords(int32_t r, int count, fixed_t* chords);
+
+/* The point at an angle on a circle.  Rounds toward the center, so it is
+   within 1/16 pixel of the exact point plus the error of the trig tables,
+   which keeps it within 1/8 pixel for radii below 2048 pixels. */
+FPoint clock_point(FPoint center, fixed_t radius, int32_t angle);
+
+/* The points on a rotated circle for count angles at once, given their
+   unit vectors (-sin, cos) scaled by TRIG_MAX_RATIO, as in kHourUnit.
+   Only the rotation is looked up, once, by the caller.  The unit vectors
+   and the rotation are each rounded, so the points are within 3/16 pixel
+   of the exact points, for radii below 1024 pixels. */
+void clock_points(FPoint center, fixed_t radius, const int32_t units[][2], int count,
+                  Rotation rotation, FPoint* points);
+
+/* The row, in whole pixels from the center, halfway between the points
+   at two angles on a circle, rounded to nearest.  This is where a chord
+   between the two points crosses the vertical, as for the horizon
+   through sunrise and sunset.  Within half a row plus 1/16 pixel of the
+   exact midpoint, above the center as well as below it. */
+int16_t chord_midpoint_row(fixed_t radius, int32_t angle0, int32_t angle1);
@@ -48,7 +48,14 @@ uint32_t usqrt(uint32_t x)
 	
 	int i;
 	
-	for (i = 0; i < BITSPERLONG; i++)   /* NOTE 1 */
+	/* Leading pairs of zero bits leave a and r at zero, so skip them.
+	   __builtin_clz is a single instruction on the Cortex-M. */
+	if (x == 0)
+		return 0;
+	i = __builtin_clz(x) >> 1;
+	x <<= 2 * i;
+	
+	for (; i < BITSPERLONG; i++)   /* NOTE 1 */
 	{
 		r = (r << 2) + TOP2BITS(x); x <<= 2; /* NOTE 2 */
 		a <<= 1;
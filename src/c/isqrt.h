@@ -1,8 +1,11 @@
-
 #pragma once
 #include "pebble.h"
 
 #define SQRT_SCALE 65536
 #define SQRT_SHIFT 16
 
+/* floor(sqrt(x) * SQRT_SCALE).  Exact for x below 2^28; above that the
+   remainder can overflow in the last steps, and the result may be off by
+   up to 3 / SQRT_SCALE.  The loop runs one step per pair of bits below
+   the highest set bit of x, plus SQRT_SHIFT steps for the fraction. */
 uint32_t usqrt(uint32_t x);
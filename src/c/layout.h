@@ -0,0 +1,23 @@
+#pragma once
+#include <pebble.h>
+#include <pebble-fctx/fctx.h>
+
+/* Geometry of the face for one size of the unobstructed area. */
+typedef struct {
+    GSize size;
+    fixed_t sunDiscRadius;
+    fixed_t hourPipRadius;
+    fixed_t sunOrbitRadius;
+    fixed_t readoutDiscRadius;
+    fixed_t dateTextGap;
+    fixed_t strokeWidth;
+    int16_t hourCapHeight;
+    int16_t timeCapHeight;
+    int16_t dateCapHeight;
+    fixed_t battery_x[14];
+} Layout;
+
+/* kFullLayout, the layout for the whole screen of the target platform,
+   and kHourUnit, the unit vectors to the hours on the dial, are generated
+   at build time by tools/layout-tables.py. */
+#include "layout-tables.h"
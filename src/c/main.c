@@ -6,23 +6,66 @@
 #include <pebble-fctx/fctx.h>
 #include <pebble-fctx/ffont.h>
 #include <pebble-utf8/pebble-utf8.h>
-#include "isqrt.h"
+#include "atlas.h"
+#include "drawlist.h"
+#include "geometry.h"
+#include "layout.h"
+#include "spans.h"
+#include "sunriset.h"
 #include "sysfont.h"
 
 // --------------------------------------------------------------------------
 // constants
 // --------------------------------------------------------------------------
 
+/* Build flags.  Any of these can be set on the compiler command line,
+   as tools/host does, or through HORIZON_DEFINES in the environment of
+   `pebble build`, e.g. HORIZON_DEFINES="PROFILE=1". */
+#ifndef SCREENSHOT
 #define SCREENSHOT 0
-#define MESSAGE_BUFFER_SIZE 200
+#endif
+#ifndef BENCHMARK
+#define BENCHMARK 0
+#endif
+#ifndef BENCHMARK_FRAMES
+#define BENCHMARK_FRAMES 1000
+#endif
+#ifndef PROFILE
+#define PROFILE 0
+#endif
+#ifndef PROFILE_FRAMES
+#define PROFILE_FRAMES 32
+#endif
+#ifndef TELEMETRY
+#define TELEMETRY 0
+#endif
+#ifndef TELEMETRY_HOURS
+#define TELEMETRY_HOURS 12
+#endif
+#ifndef DRAW_LIST_DEBUG
+#define DRAW_LIST_DEBUG 0
+#endif
+#ifndef HEAP_DEBUG
+#define HEAP_DEBUG 0
+#endif
+#define RECORD_VERSION 1
+#define SUN_TABLE_DAYS 30
 #define CLOCK_ANIM_DURATION 1000
+#define CLOCK_ANIM_FRAME_CAP 20
+#define DIAL_HEAP_MARGIN 2048
+#define POLICY_WAKE_MINUTES 2
+#define POLICY_LOW_BATTERY 2
 const char* kDateFormat = "%b %d";
 const char* kWeekdayFormat = "%a";
+static const char* kHourLabels[] = { "00", "06", "12", "18" };
 
 // --------------------------------------------------------------------------
 // globals
 // --------------------------------------------------------------------------
 
+/* Keys up to PersistKeyPalette hold the version 1 layout, one value per
+   key.  They are only read to migrate an old install to the PersistState
+   record. */
 typedef enum PersistKeys {
     PersistKeyVersion,
     PersistKeyLocation,
@@ -37,8 +80,13 @@ typedef enum PersistKeys {
     PersistKeyBluetooth,
     PersistKeyBattery,
     PersistKeyPalette,
+    PersistKeySunTable,
+    PersistKeyState,
+    PersistKeyTelemetry,
 } PersistKeys;
 
+#define PERSIST_VERSION 2
+
 enum Palette {
     PaletteColorBehind,
     PaletteColorBelow,
@@ -89,7 +137,11 @@ static const uint8_t kDefaultPalette[PaletteSize] = {
 };
 #endif
 
-static void gctx_draw_string(FContext* fctx, const char* str, SystemFont* font, GTextAlignment align, FTextAnchor anchor) {
+/* Draw a string in a system font, anchored like fctx_draw_string.  The
+   width is only needed to align the string center or right, and is
+   measured into *width if that is negative. */
+static void gctx_draw_string(FContext* fctx, const char* str, SystemFont* font, GTextAlignment align, FTextAnchor anchor,
+                             int16_t* width) {
 
     if (font->font == NULL) {
         font->font = fonts_get_system_font(font->key);
@@ -108,12 +160,14 @@ static void gctx_draw_string(FContext* fctx, const char* str, SystemFont* font,
     if (align == GTextAlignmentLeft) {
         box.origin.x = offset.x;
     } else {
-        GSize size = graphics_text_layout_get_content_size(
-            str, font->font, box, overflow, GTextAlignmentLeft);
+        if (*width < 0) {
+            *width = graphics_text_layout_get_content_size(
+                str, font->font, box, overflow, GTextAlignmentLeft).w;
+        }
         if (align == GTextAlignmentRight) {
-            box.origin.x = offset.x - size.w;
+            box.origin.x = offset.x - *width;
         } else /* align == GTextAlignmentCenter */ {
-            box.origin.x = offset.x - size.w / 2;
+            box.origin.x = offset.x - *width / 2;
         }
     }
 
@@ -142,6 +196,55 @@ typedef struct {
     int32_t sunstat;
 } LocationFix;
 
+/* Everything that survives a restart, except the sun table, which is too
+   big to share the 256 byte limit of a persist key.  Written as a whole,
+   and only when it differs from what is already stored. */
+typedef struct __attribute__((packed)) {
+    uint8_t version;
+    uint8_t bluetoothAlert;
+    bool batteryIndicator;
+    uint8_t paletteLength;
+    uint8_t palette[PaletteSize];
+    int32_t timestamp;
+    int32_t timezone;
+    int32_t longitude;
+    int32_t latitude;
+} PersistState;
+
+/* Sun events for consecutive days, as sent by the phone.  The first day
+   is counted from 1970-01-01, in the local time of the fix. */
+typedef struct __attribute__((packed)) {
+    uint16_t firstDay;
+    uint8_t count;
+    SunEvents days[SUN_TABLE_DAYS];
+} SunTable;
+
+/* The phone sends everything in one RECORD byte array:
+
+     uint8   version         RECORD_VERSION
+     uint8   contents        RecordConfig | RecordLocation
+     if RecordConfig:
+       uint8   bluetooth
+       uint8   battery
+       uint8   paletteLength
+       uint8   palette[paletteLength]
+     if RecordLocation:
+       int32   timestamp, timezone, longitude, latitude
+       SunTable, truncated to its count
+
+   All values are little endian. */
+enum RecordContents {
+    RecordConfig = 1 << 0,
+    RecordLocation = 1 << 1,
+};
+
+#define RECORD_SIZE_MAX (2 + 3 + PaletteSize + 4 * sizeof(int32_t) + sizeof(SunTable))
+
+typedef struct {
+    const uint8_t* data;
+    const uint8_t* end;
+} RecordReader;
+
 typedef struct {
     int16_t from;
     int16_t to;
@@ -154,80 +257,340 @@ typedef struct {
     int32_t current;
 } int32_anim_t;
 
+/* A string of the readout, formatted once for as long as it shows, and
+   measured once if it is drawn with a system font. */
+typedef struct {
+    char text[16];
+    int16_t width;      // system font content width, -1 until measured
+} TextEntry;
+
+/* What changed since the last frame.  Events only record these, and one
+   redraw is scheduled for a burst of them. */
+enum Dirty {
+    DirtyTime = 1 << 0,       // the time text
+    DirtySun = 1 << 1,        // the sun position
+    DirtyDishes = 1 << 2,     // battery and bluetooth
+    DirtyPalette = 1 << 3,
+    DirtyLayout = 1 << 4,
+    DirtyDial = 1 << 5,       // the horizon or the rotation
+    DirtyFrame = 1 << 6,      // the framebuffer was lost, the caches hold
+    DirtyAll = 0xff,
+};
+
+/* Each layer paints over the ones below, so it is drawn if anything it
+   shows changed, or if a layer below it was drawn. */
+#define DIRTY_DIAL (DirtySun | DirtyPalette | DirtyLayout | DirtyDial | DirtyFrame)
+#define DIRTY_READOUT (DIRTY_DIAL | DirtyTime | DirtyDishes)
+
+/* Frames that are only on screen for a moment, during an animation or a
+   slide of the unobstructed area, are drawn in draft quality, without
+   antialiasing.  The frame after it settles is drawn in full. */
+typedef enum {
+    QualityFull,
+    QualityDraft,
+    QualityCount,
+} RenderQuality;
+
+typedef struct {
+    uint16_t frames;
+    uint32_t millis;
+} QualityStats;
+
+/* Conditions that the tick policy is chosen from. */
+enum PolicyCondition {
+    PolicyAwake = 1 << 0,       // tapped within POLICY_WAKE_MINUTES
+    PolicyLowBattery = 1 << 1,  // discharging, at or below POLICY_LOW_BATTERY
+    PolicyNight = 1 << 2,       // sun below the horizon
+    PolicyOffline = 1 << 3,     // phone disconnected
+};
+
+/* How much work the face does while its conditions hold. */
+typedef struct {
+    uint8_t conditions;
+    uint8_t sunStep;    // minutes between steps of the sun along its orbit
+    bool animate;
+    RenderQuality quality;
+    const char* name;
+} TickPolicy;
+
+/* Counts since the policy last changed, logged when it changes again.
+   The skipped and held counts are the work the policy saved. */
+typedef struct {
+    uint16_t ticks;
+    uint16_t frames;
+    uint16_t dialSkipped;
+    uint16_t sunSkipped;
+    uint16_t sunSteps;
+    uint16_t sunStepsHeld;
+    uint16_t animationsSkipped;
+    uint16_t animationFramesSkipped;
+} PolicyCounters;
+
 struct Clock {
 
     // layout
-    fixed_t sunDiscRadius;
-    fixed_t hourPipRadius;
-    fixed_t sunOrbitRadius;
-    fixed_t readoutDiscRadius;
-    fixed_t dateTextGap;
-    fixed_t strokeWidth;
-    int16_t hourCapHeight;
-    int16_t timeCapHeight;
-    int16_t dateCapHeight;
+    Layout layout;
+    Layout obstructedLayout;
     SystemFont* dateFont;
-    fixed_t battery_x[14];
 
     // configuration
     uint8_t bluetoothAlert;
     bool batteryIndicator;
+    uint8_t paletteLength;
+    uint8_t palette[PaletteSize];
     GColor colors[PaletteSize];
+    PersistState persisted;
 
     // external state
     struct tm gregorian;
     bool bluetooth;
     uint16_t battery;
+    bool charging;
     LocationFix location;
+    SunTable sunTable;
 
     // computed state
     uint16_t horizon;
     int32_t kilter;
-    char strbuf[32];
+    TextEntry timeText;
+    TextEntry weekdayText;
+    TextEntry dateText;
+    int16_t textMinute;
+    bool text24h;
+    int32_t textDay;
+
+    // tick policy
+    const TickPolicy* policy;
+    time_t wakeTime;
+    uint16_t sunMinute;
+    PolicyCounters counters;
 
     // animated state
     int16_anim_t above;
     int16_anim_t below;
     int32_anim_t rotation;
 
+    // fctx scratch, kept for the life of the face
+    FContext fctxArena;
+    bool fctxArenaReady;
+
+    // retained dial
+    uint8_t* dialCache;
+    GRect dialBounds;
+    int16_t dialAbove;
+    int16_t dialBelow;
+    bool dialValid;
+
+    // hour label masks, only while the rotation animates
+    SpanMask* labelMasks[4];
+
+    // retained readout, only while animating
+    uint8_t* readoutCache;
+    bool readoutValid;
+
+    // redraw scheduling
+    uint8_t dirty;
+    uint8_t frameDirty;
+    bool frameRequested;
+    AppTimer* redrawTimer;
+
+    // render quality
+    RenderQuality quality;
+    bool sliding;
+    uint32_t qualityFrameStart;
+    QualityStats qualityStats[QualityCount];
+
+    // animation frame pacing
+    uint32_t frameTime;
+    bool framePending;
+    uint16_t framesRendered;
+    uint16_t framesDropped;
+
     AnimationImplementation animationImplementation;
     Animation* animation;
     Window* window;
-    Layer* layer;
+    Layer* dialLayer;
+    Layer* sunLayer;
+    Layer* readoutLayer;
+    Layer* textLayer;
     FFont* font;
+    DigitAtlas* digits;
 
 } g;
 
 static void init();
 static void deinit();
+static void updateSunEvents();
+static void positionClock();
 static void configureClock();
+#if !SCREENSHOT
 static void animateClock();
 static void interpolateClock(Animation* animation, const AnimationProgress progress);
-static void drawClock(Layer* layer, GContext* ctx);
+#endif
+static void drawDialLayer(Layer* layer, GContext* ctx);
+static void drawSunLayer(Layer* layer, GContext* ctx);
+static void drawReadoutLayer(Layer* layer, GContext* ctx);
+static void drawTextLayer(Layer* layer, GContext* ctx);
+static void drawTextDone();
+static void drawDial(FContext* fctx, GRect bounds, int16_t top, int16_t bottom);
+static void buildLabelMasks(FContext* fctx, GRect bounds);
+static void freeLabelMasks();
+static void invalidateDial();
+static bool restoreReadoutArea(GContext* ctx, GRect bounds);
+static bool restoreDial(GContext* ctx, GRect bounds);
+static void captureDial(GContext* ctx, GRect bounds);
+static bool dialBand(GRect bounds, int16_t* top, int16_t* bottom);
+static void invalidateReadout();
+static bool restoreReadout(GContext* ctx, GRect bounds);
+static void captureReadout(GContext* ctx, GRect bounds);
 static void drawBatteryDish(FContext* fctx, int height);
+static void beginFContext(FContext* fctx, GContext* ctx);
+static void updateQuality();
+static void logQuality();
+static void endFContext(FContext* fctx);
+static void plotDish(FContext* fctx, int32_t height);
+static GRect dishBounds(GPoint center, int32_t height);
+static void batteryStateChanged(BatteryChargeState charge);
+static void windowAppeared(Window* window);
+static void focusChanged(bool inFocus);
+static bool applyPolicy();
+static void stepSun();
+#if !SCREENSHOT
 static void timeChanged(struct tm* tickTime, TimeUnits unitsChanged);
 static void bluetoothConnected(bool connected);
-static void batteryStateChanged(BatteryChargeState charge);
+static void tapped(AccelAxisType axis, int32_t direction);
 static void messageReceived(DictionaryIterator* iterator, void *context);
+#endif
+static void unobstructedWillChange(GRect final, void* context);
+static void unobstructedChange(AnimationProgress progress, void* context);
+static void unobstructedDidChange(void* context);
 
-static FPoint clockPoint(FPoint center, fixed_t radius, uint32_t angle);
+static void computeLayout(Layout* layout, GSize size);
+static void applyLayout(GSize size);
+
+static void hourPoints(FPoint center, FPoint* points);
 static GColor colorFromConfig(uint8_t cc);
 static void applyPalette(const uint8_t* palette, int16_t length);
+#if !SCREENSHOT
+static uint8_t readUint8(RecordReader* reader);
+static int32_t readInt32(RecordReader* reader);
+static int readBytes(RecordReader* reader, void* buffer, int length, int capacity);
+#endif
+static void loadState();
+static void saveState();
 
 static void logLocationFix(LocationFix* loc);
 
+#if BENCHMARK
+typedef enum {
+    BenchPhaseDial,
+    BenchPhaseSun,
+    BenchPhaseReadout,
+    BenchPhaseText,
+    BenchPhaseCount,
+} BenchPhase;
+
+static void benchStart(void* context);
+static void benchPhase(BenchPhase phase);
+static void benchFrameDone();
+#else
+#define benchPhase(phase)
+#define benchFrameDone()
+#endif
+
+#if SCREENSHOT
+static void screenshotScene();
+static void screenshotFrameBegin();
+static void screenshotFrameDone();
+#else
+#define screenshotFrameBegin()
+#define screenshotFrameDone()
+#endif
+
+#if HEAP_DEBUG
+static void heapSample();
+#else
+#define heapSample()
+#endif
+
+#if PROFILE
+typedef enum {
+    ProfilePhaseBackground,
+    ProfilePhasePips,
+    ProfilePhaseLabels,
+    ProfilePhaseSun,
+    ProfilePhaseReadout,
+    ProfilePhaseDishes,
+    ProfilePhaseStroke,
+    ProfilePhaseText,
+    ProfilePhaseCount,
+} ProfilePhase;
+
+static void profileFrameBegin();
+static void profileStart();
+static void profileEnd(ProfilePhase phase);
+static void profileSend();
+#else
+#define profileFrameBegin()
+#define profileStart()
+#define profileEnd(phase)
+#endif
+
+#if TELEMETRY
+typedef enum {
+    TelemetryMinuteRedraws,
+    TelemetryAnimationFrames,
+    TelemetryInboxEvents,
+    TelemetryInboxBytes,
+    TelemetryPersistWrites,
+    TelemetryBatteryEvents,
+    TelemetryBluetoothEvents,
+    TelemetryDrawMillis,
+    TelemetryCount,
+} TelemetryCounter;
+
+static void telemetryLoad();
+static void telemetrySave();
+static void telemetryAdd(TelemetryCounter counter, uint32_t amount);
+static void telemetrySend();
+#else
+#define telemetryLoad()
+#define telemetrySave()
+#define telemetryAdd(counter, amount)
+#endif
+
 // --------------------------------------------------------------------------
 // inline utility functions
 // --------------------------------------------------------------------------
 
-/* Convert hours to angle, measured clockwise from midnight. */
-static inline int32_t hourAngle(int32_t hour) {
-    return hour * TRIG_MAX_ANGLE / 24;
+/* Milliseconds, from an arbitrary origin. */
+static inline uint32_t clockMillis() {
+    time_t seconds;
+    uint16_t millis;
+    time_ms(&seconds, &millis);
+    return seconds * 1000 + millis;
 }
 
-/* Convert minutes to angle, measured clockwise from midnight. */
-static inline int32_t minuteAngle(int32_t minute) {
-    return minute * TRIG_MAX_ANGLE / (24*60);
+static inline Layer* createClockLayer(Layer* parent, GRect frame, LayerUpdateProc update) {
+    Layer* layer = layer_create(frame);
+    layer_set_update_proc(layer, update);
+    layer_add_child(parent, layer);
+    return layer;
+}
+
+static void scheduleRedraw(uint8_t dirty);
+
+/* Paint the whole frame again, from the caches where they are valid. */
+static inline void markClockDirty() {
+    scheduleRedraw(DirtyFrame);
+}
+
+static inline int16_t minInt16(int16_t a, int16_t b) {
+    return (a < b) ? a : b;
+}
+
+static inline int16_t maxInt16(int16_t a, int16_t b) {
+    return (a > b) ? a : b;
 }
 
 static inline int16_t sizeInner(GSize size) {
@@ -245,6 +608,7 @@ int main() {
     init();
     app_event_loop();
     deinit();
+    return 0;
 }
 
 // --------------------------------------------------------------------------
@@ -260,99 +624,62 @@ static void init() {
 
     /* --- Restore state from persistent storage. --- */
 
-    int version = persist_read_int(PersistKeyVersion);
-    if (version < 1) {
-        /* remove persistent data from old install */
-        for (uint32_t key = 100; key < 113; ++key) {
-            persist_delete(key);
-        }
-        persist_write_int(PersistKeyVersion, 1);
-    }
-
-    if (persist_exists(PersistKeyBattery)) {
-        g.batteryIndicator = persist_read_bool(PersistKeyBattery);
-    } else {
-        g.batteryIndicator = true;
-    }
-
-    if (persist_exists(PersistKeyBluetooth)) {
-        g.bluetoothAlert = persist_read_int(PersistKeyBluetooth);
-    } else {
-        g.bluetoothAlert = 1;
-    }
-
-    if (persist_exists(PersistKeyPalette)) {
-        uint8_t palette[PaletteSize];
-        int length = persist_read_data(PersistKeyPalette, palette, PaletteSize);
-        applyPalette(palette, length);
-    } else {
-        applyPalette(kDefaultPalette, PaletteSize);
-    }
+    /* Telemetry first, since an upgrade in loadState saves, and counts
+       the write. */
+    telemetryLoad();
+    loadState();
 
-    if (persist_exists(PersistKeyTimestamp)) {
-        g.location.timestamp = persist_read_int(PersistKeyTimestamp);
-        g.location.timezone  = persist_read_int(PersistKeyTimezone);
-        g.location.longitude = persist_read_int(PersistKeyLongitude);
-        g.location.latitude  = persist_read_int(PersistKeyLatitude);
-        g.location.sunrise   = persist_read_int(PersistKeySunrise);
-        g.location.sunset    = persist_read_int(PersistKeySunset);
-        g.location.sunsouth  = persist_read_int(PersistKeySunSouth);
-        g.location.sunstat   = persist_read_int(PersistKeySunStatus);
-        logLocationFix(&g.location);
+    if (persist_exists(PersistKeySunTable)) {
+        persist_read_data(PersistKeySunTable, &g.sunTable, sizeof(g.sunTable));
     } else {
-        g.location.timestamp = 0;
+        g.sunTable.count = 0;
     }
 
     /* --- Allocate system resources. --- */
 
+    g.frameDirty = DirtyAll;
     g.window = window_create();
-    window_set_background_color(g.window, GColorBlack);
+    /* Leave the framebuffer alone, so that the layers a frame does not
+       change can skip drawing. */
+    window_set_background_color(g.window, GColorClear);
+    window_set_window_handlers(g.window, (WindowHandlers) {
+        .appear = windowAppeared,
+    });
     window_stack_push(g.window, true);
     Layer* windowLayer = window_get_root_layer(g.window);
     GRect frame = layer_get_frame(windowLayer);
 
-    g.layer = layer_create(frame);
-    layer_set_update_proc(g.layer, &drawClock);
-    layer_add_child(windowLayer, g.layer);
+    /* Each component of the scene gets its own layer, so that an event
+       only marks dirty what it actually changes.  They are stacked in
+       painting order. */
+    g.dialLayer = createClockLayer(windowLayer, frame, &drawDialLayer);
+    g.sunLayer = createClockLayer(windowLayer, frame, &drawSunLayer);
+    g.readoutLayer = createClockLayer(windowLayer, frame, &drawReadoutLayer);
+    g.textLayer = createClockLayer(windowLayer, frame, &drawTextLayer);
 
     g.animation = NULL;
 
     g.font = ffont_create_from_resource(RESOURCE_ID_DIN_CONDENSED_FFONT);
+    g.digits = digit_atlas_create_from_resource(RESOURCE_ID_DIGIT_ATLAS);
 
     /* --- Calculate layout. --- */
 
-    int16_t designRadius = sizeInner(frame.size) / 2 - PBL_IF_ROUND_ELSE(4, 0);       // 72
-    g.sunDiscRadius = designRadius * 3 / 25;                                          // 8
-    g.hourCapHeight = g.sunDiscRadius * 25 / 17;                                      // 11
-    int16_t sunDiscMargin = g.sunDiscRadius * 1 / 3;                                  // 2
-    g.sunOrbitRadius = designRadius - sunDiscMargin - g.sunDiscRadius;                // 62
-    g.readoutDiscRadius = g.sunOrbitRadius - g.sunDiscRadius - sunDiscMargin;         // 52
-    g.timeCapHeight = (g.readoutDiscRadius * 10 / 21) / 2 * 2;                        // 24
-    g.dateCapHeight = g.readoutDiscRadius * 3 / 11;                                   // 14
-    g.dateTextGap = g.readoutDiscRadius * 4 / 50;                                     // 4
-    g.strokeWidth = 2;
-
 #if defined(PBL_BW)
     g.dateFont = &Gothic18Bold;
 #endif
 
-    int32_t r = g.readoutDiscRadius - g.strokeWidth / 2;
-    for (uint32_t k = 0; k < ARRAY_LENGTH(g.battery_x); ++k) {
-        int32_t y = r - k;
-        uint32_t q = usqrt(r*r - y*y);
-        g.battery_x[k] = q / (SQRT_SCALE / FIXED_POINT_SCALE);
+    g.layout = kFullLayout;
+    GRect unobstructed = layer_get_unobstructed_bounds(windowLayer);
+    if (!gsize_equal(&unobstructed.size, &kFullLayout.size)) {
+        computeLayout(&g.obstructedLayout, unobstructed.size);
+        g.layout = g.obstructedLayout;
     }
 
-    g.sunDiscRadius *= FIXED_POINT_SCALE;
-    g.sunOrbitRadius *= FIXED_POINT_SCALE;
-    g.readoutDiscRadius *= FIXED_POINT_SCALE;
-    g.dateTextGap *= FIXED_POINT_SCALE;
-    g.strokeWidth *= FIXED_POINT_SCALE;
-
-    g.hourPipRadius = g.sunDiscRadius * 1 / 4;
-
     /* --- Initialize the clock state. --- */
 
+#if SCREENSHOT
+    screenshotScene();
+#else
     time_t now = time(NULL);
     g.gregorian = *localtime(&now);
     g.kilter = 0;
@@ -360,8 +687,10 @@ static void init() {
     g.bluetooth = bluetooth_connection_service_peek();
 
     batteryStateChanged(battery_state_service_peek());
+#endif
 
     configureClock();
+    applyPolicy();
 
     if (0 == g.location.timestamp) {
         g.above.current = -frame.size.h / 2;
@@ -375,12 +704,29 @@ static void init() {
 
     /* --- Activate system services. --- */
 
+#if !SCREENSHOT
     app_message_register_inbox_received(messageReceived);
-    app_message_open(MESSAGE_BUFFER_SIZE, APP_MESSAGE_OUTBOX_SIZE_MINIMUM);
+    app_message_open(dict_calc_buffer_size(1, RECORD_SIZE_MAX), APP_MESSAGE_OUTBOX_SIZE_MINIMUM);
 
     tick_timer_service_subscribe(MINUTE_UNIT | DAY_UNIT, &timeChanged);
     bluetooth_connection_service_subscribe(&bluetoothConnected);
     battery_state_service_subscribe(&batteryStateChanged);
+    accel_tap_service_subscribe(&tapped);
+#endif
+    app_focus_service_subscribe_handlers((AppFocusHandlers) {
+        .did_focus = focusChanged,
+    });
+#if PBL_API_EXISTS(unobstructed_area_service_subscribe)
+    unobstructed_area_service_subscribe((UnobstructedAreaHandlers) {
+        .will_change = unobstructedWillChange,
+        .change = unobstructedChange,
+        .did_change = unobstructedDidChange,
+    }, NULL);
+#endif
+
+#if BENCHMARK
+    app_timer_register(1000, benchStart, NULL);
+#endif
 }
 
 // --------------------------------------------------------------------------
@@ -388,19 +734,73 @@ static void init() {
 // --------------------------------------------------------------------------
 
 static void deinit() {
+    telemetrySave();
     tick_timer_service_unsubscribe();
     bluetooth_connection_service_unsubscribe();
     battery_state_service_unsubscribe();
+    accel_tap_service_unsubscribe();
+    app_focus_service_unsubscribe();
+#if PBL_API_EXISTS(unobstructed_area_service_unsubscribe)
+    unobstructed_area_service_unsubscribe();
+#endif
     window_destroy(g.window);
-    layer_destroy(g.layer);
+    layer_destroy(g.dialLayer);
+    layer_destroy(g.sunLayer);
+    layer_destroy(g.readoutLayer);
+    layer_destroy(g.textLayer);
     ffont_destroy(g.font);
+    digit_atlas_destroy(g.digits);
+    free(g.dialCache);
+    free(g.readoutCache);
+    freeLabelMasks();
+    if (g.fctxArenaReady) {
+        fctx_deinit_context(&g.fctxArena);
+    }
 }
 
 // --------------------------------------------------------------------------
 
 // --------------------------------------------------------------------------
 
-void configureClock() {
+/* Days since 1970-01-01 of a calendar date. */
+static int32_t dayNumber(const struct tm* date) {
+    int32_t y = date->tm_year + 1900 - 1;
+    return y*365 + y/4 - y/100 + y/400 - 719162 + date->tm_yday;
+}
+
+/* Find today's sun events, preferably in the table from the phone, or
+   else compute them on the watch from the last known position, so that
+   the horizon stays current without a fresh fix. */
+void updateSunEvents() {
+
+    if (0 == g.location.timestamp) {
+        return;
+    }
+
+    if (clock_is_timezone_set()) {
+        g.location.timezone = g.gregorian.tm_gmtoff / 60;
+    }
+
+    SunEvents sun;
+    int32_t index = dayNumber(&g.gregorian) - g.sunTable.firstDay;
+    if (index >= 0 && index < g.sunTable.count) {
+        sun = g.sunTable.days[index];
+    } else {
+        sun_rise_set(g.gregorian.tm_year + 1900, g.gregorian.tm_mon + 1, g.gregorian.tm_mday,
+                     g.location.longitude, g.location.latitude, &sun);
+    }
+    g.location.sunrise = sun.rise;
+    g.location.sunset = sun.set;
+    g.location.sunsouth = sun.south;
+    g.location.sunstat = sun.status;
+}
+
+/* Place the horizon and the kilter from the current sun events.  Only
+   the horizon depends on the layout, so a change of layout comes here
+   without recomputing the events. */
+void positionClock() {
+
+    invalidateDial();
 
     if (0 == g.location.timestamp) {
         g.kilter = 0;
@@ -414,25 +814,43 @@ void configureClock() {
     int32_t sunSet = g.location.sunset + timezone;
     int32_t sunSouth = g.location.sunsouth + timezone;
 
-    g.kilter = minuteAngle(12*60 - sunSouth);
-
-    FPoint origin = FPointZero;
-    int32_t sunriseAngle = minuteAngle(sunRise);
-    int32_t sunsetAngle = minuteAngle(sunSet);
-    FPoint sunrisePoint = clockPoint(origin, g.sunOrbitRadius, sunriseAngle + g.kilter);
-    FPoint sunsetPoint = clockPoint(origin, g.sunOrbitRadius, sunsetAngle + g.kilter);
+    g.kilter = minute_angle(12*60 - sunSouth);
+    g.horizon = chord_midpoint_row(g.layout.sunOrbitRadius,
+                                   minute_angle(sunRise) + g.kilter,
+                                   minute_angle(sunSet) + g.kilter);
+}
 
-    g.horizon = FIXED_TO_INT((sunrisePoint.y + sunsetPoint.y + FIX1) / 2);
+void configureClock() {
+    updateSunEvents();
+    positionClock();
 }
 
 // --------------------------------------------------------------------------
 
 // --------------------------------------------------------------------------
 
+/* Scenes are drawn settled, so screenshot builds never animate. */
+#if !SCREENSHOT
 static void anim_stopped_handler(Animation *animation, bool finished, void *context) {
     if (animation == g.animation) {
         animation_destroy(g.animation);
         g.animation = NULL;
+        APP_LOG(APP_LOG_LEVEL_DEBUG, "animation: %d frames rendered, %d dropped",
+                g.framesRendered, g.framesDropped);
+        /* The readout cache is only worth its memory while animating. */
+        invalidateReadout();
+        free(g.readoutCache);
+        g.readoutCache = NULL;
+        /* The labels go back to full quality vectors. */
+        freeLabelMasks();
+        /* Settle on the targets, in case the layout changed after the
+           last frame. */
+        g.above.current = g.above.to;
+        g.below.current = g.below.to;
+        g.rotation.current = g.rotation.to;
+        updateQuality();
+        logQuality();
+        scheduleRedraw(DirtyDial);
     }
 }
 
@@ -445,11 +863,17 @@ void animateClock() {
     bool skipAbove = abs(g.above.current - g.horizon) < horizonThreshold;
     bool skipBelow = abs(g.below.current - g.horizon) < horizonThreshold;
     bool skipRotation = abs(g.rotation.current - g.kilter) < kilterThreshold;
-    if (skipAbove && skipBelow && skipRotation) {
+    bool skipAnimation = skipAbove && skipBelow && skipRotation;
+    if (!skipAnimation && !g.policy->animate) {
+        ++g.counters.animationsSkipped;
+        g.counters.animationFramesSkipped += CLOCK_ANIM_DURATION * CLOCK_ANIM_FRAME_CAP / 1000;
+        skipAnimation = true;
+    }
+    if (skipAnimation) {
         g.above.current = g.horizon;
         g.below.current = g.horizon;
         g.rotation.current = g.kilter;
-        layer_mark_dirty(g.layer);
+        scheduleRedraw(DirtyDial);
         return;
     }
 
@@ -462,6 +886,11 @@ void animateClock() {
     g.rotation.from = g.rotation.current;
     g.rotation.to = g.kilter;
 
+    g.frameTime = 0;
+    g.framePending = false;
+    g.framesRendered = 0;
+    g.framesDropped = 0;
+
     g.animationImplementation.setup = NULL;
     g.animationImplementation.update = &interpolateClock;
     g.animationImplementation.teardown = NULL;
@@ -475,6 +904,7 @@ void animateClock() {
         .stopped = anim_stopped_handler
     }, NULL);
     animation_schedule(g.animation);
+    updateQuality();
 }
 
 void interpolateClock(Animation* animation, const AnimationProgress progress) {
@@ -483,21 +913,65 @@ void interpolateClock(Animation* animation, const AnimationProgress progress) {
     AnimationProgress t = progress - ANIMATION_NORMALIZED_MIN;
 
     // from + (to - from) * t
+    int32_t rotation = g.rotation.current;
     g.above.current = g.above.from + (g.above.to - g.above.from) * t / norm;
     g.below.current = g.below.from + (g.below.to - g.below.from) * t / norm;
     g.rotation.current = g.rotation.from + (g.rotation.to - g.rotation.from) * t / norm;
-    layer_mark_dirty(g.layer);
+
+    /* A moving horizon alone is repainted as a band over the cached dial,
+       but a rotation changes every marking. */
+    if (g.rotation.current != rotation) {
+        invalidateDial();
+    }
+
+    /* Skip frames that come faster than the frame cap, or while the last
+       one is still waiting to be drawn, but never skip the final frame. */
+    uint32_t now = clockMillis();
+    if (progress < ANIMATION_NORMALIZED_MAX
+        && (g.framePending || now - g.frameTime < 1000 / CLOCK_ANIM_FRAME_CAP)) {
+        ++g.framesDropped;
+        return;
+    }
+    g.frameTime = now;
+    g.framePending = true;
+    g.frameDirty |= DirtyDial;
+    g.frameRequested = true;
+    layer_mark_dirty(g.dialLayer);
 }
+#endif
 
-void formatTime() {
-    if (clock_is_24h_style()) {
-        /* For 24h format, use strftime, because clock_copy_string does
-           not prepend a leading zero to single digit hours. */
-        strftime(g.strbuf, ARRAY_LENGTH(g.strbuf), "%H:%M", &g.gregorian);
-    } else {
-        int hour = g.gregorian.tm_hour % 12;
-        if (hour == 0) hour = 12;
-        snprintf(g.strbuf, ARRAY_LENGTH(g.strbuf), "%d:%02d", hour, g.gregorian.tm_min);
+static void formatText(TextEntry* entry, const char* format) {
+    strftime(entry->text, ARRAY_LENGTH(entry->text), format, &g.gregorian);
+    utf8_str_to_upper(entry->text);
+    entry->width = -1;
+}
+
+/* Bring the readout strings up to date.  The time is formatted once a
+   minute, or when the 12/24h setting changes, and the weekday and date
+   once a day. */
+void updateText() {
+    int16_t minute = g.gregorian.tm_hour * 60 + g.gregorian.tm_min;
+    bool is24h = clock_is_24h_style();
+    if (minute != g.textMinute || is24h != g.text24h || !g.timeText.text[0]) {
+        if (is24h) {
+            /* For 24h format, use strftime, because clock_copy_string does
+               not prepend a leading zero to single digit hours. */
+            strftime(g.timeText.text, ARRAY_LENGTH(g.timeText.text), "%H:%M", &g.gregorian);
+        } else {
+            int hour = g.gregorian.tm_hour % 12;
+            if (hour == 0) hour = 12;
+            snprintf(g.timeText.text, ARRAY_LENGTH(g.timeText.text), "%d:%02d", hour, g.gregorian.tm_min);
+        }
+        g.timeText.width = -1;
+        g.textMinute = minute;
+        g.text24h = is24h;
+    }
+
+    int32_t day = dayNumber(&g.gregorian);
+    if (day != g.textDay || !g.dateText.text[0]) {
+        formatText(&g.weekdayText, kWeekdayFormat);
+        formatText(&g.dateText, kDateFormat);
+        g.textDay = day;
     }
 }
 
@@ -505,153 +979,193 @@ void formatTime() {
 
 // --------------------------------------------------------------------------
 
-void drawClock(Layer* layer, GContext* ctx) {
+void drawDialLayer(Layer* layer, GContext* ctx) {
 
-#if SCREENSHOT
-    g.gregorian.tm_hour = 13;
-    g.gregorian.tm_min = 50;
-    g.battery = 10;
-#endif
+    benchPhase(BenchPhaseDial);
+    profileFrameBegin();
+    screenshotFrameBegin();
+    heapSample();
+    g.qualityFrameStart = clockMillis();
+
+    /* A redraw that the face did not ask for, as after a notification,
+       has to paint everything, but the caches still hold. */
+    if (!g.frameRequested) {
+        g.frameDirty |= DirtyFrame;
+    }
 
     GRect bounds = layer_get_unobstructed_bounds(layer);
-    GPoint center = grect_center_point(&bounds);
-    FPoint fcenter = g2fpoint(center);
-    GRect fill = bounds;
-    GPoint left;
-    GPoint right;
-    left.x = bounds.origin.x;
-    right.x = bounds.origin.x + bounds.size.w;
-
-    /* Fill the space behind everything. */
-    graphics_context_set_fill_color(ctx, g.colors[PaletteColorBehind]);
-    graphics_fill_rect(ctx, fill, 0, GCornerNone);
-
-    /* Fill the space above the horizon. */
-    fill.origin.y = 0;
-    fill.size.h = center.y + g.above.current;
-    left.y = right.y = center.y + g.above.current - 1;
-    graphics_context_set_fill_color(ctx, g.colors[PaletteColorAbove]);
-    graphics_fill_rect(ctx, fill, 0, GCornerNone);
-    graphics_context_set_stroke_color(ctx, g.colors[PaletteColorMarks]);
-    graphics_draw_line(ctx, left, right);
-
-    /* Fill the space below the horizon. */
-    fill.origin.y = center.y + g.below.current;
-    fill.size.h = bounds.origin.y + bounds.size.h - fill.origin.y;
-    left.y = right.y = center.y + g.below.current;
-    graphics_context_set_fill_color(ctx, g.colors[PaletteColorBelow]);
-    graphics_fill_rect(ctx, fill, 0, GCornerNone);
-    graphics_draw_line(ctx, left, right);
+
+    /* The readout is antialiased over what is under it, so before it is
+       drawn again the area under it goes back to the bare dial.  Without
+       a cached dial, the dial and everything on it is drawn. */
+    if (!(g.frameDirty & DIRTY_DIAL)) {
+        if (!(g.frameDirty & DIRTY_READOUT) || restoreReadoutArea(ctx, bounds)) {
+            ++g.counters.dialSkipped;
+            return;
+        }
+        g.frameDirty |= DirtyDial;
+    }
+
+    int16_t top = bounds.origin.y;
+    int16_t bottom = bounds.origin.y + bounds.size.h;
+
+    /* The dial only changes with the horizon, the rotation, the palette
+       and the bounds, so most redraws can blit it from the cache.  If
+       only the horizon has moved since, just the band it swept over is
+       painted on top. */
+    if (restoreDial(ctx, bounds) && !dialBand(bounds, &top, &bottom)) {
+        return;
+    }
 
     FContext fctx;
-    fctx_init_context(&fctx, ctx);
+    beginFContext(&fctx, ctx);
+    drawDial(&fctx, bounds, top, bottom);
+    endFContext(&fctx);
+    captureDial(ctx, bounds);
+}
 
-    /* Draw the solar orbit markings. */
-    fctx_begin_fill(&fctx);
-    fctx_set_fill_color(&fctx, g.colors[PaletteColorMarks]);
-    fctx_set_color_bias(&fctx, 0);
-    for (int h = 0; h < 24; ++h) {
-        FPoint c = clockPoint(fcenter, g.sunOrbitRadius, hourAngle(h) + g.rotation.current);
-        if (h % 6) {
-            fctx_plot_circle(&fctx, &c, g.hourPipRadius);
-#ifdef PBL_COLOR
-        } else {
-            fctx_plot_circle(&fctx, &c, g.sunDiscRadius);
-#endif
-        }
+void drawSunLayer(Layer* layer, GContext* ctx) {
+
+    benchPhase(BenchPhaseSun);
+
+    if (!(g.frameDirty & DIRTY_DIAL)) {
+        ++g.counters.sunSkipped;
+        return;
     }
-    fctx_end_fill(&fctx);
-    fctx_set_color_bias(&fctx, 0);
 
-    fctx_begin_fill(&fctx);
-    fctx_set_fill_color(&fctx, g.colors[PBL_IF_COLOR_ELSE(PaletteColorSolar, PaletteColorMarks)]);
-    fctx_set_text_cap_height(&fctx, g.font, PBL_IF_COLOR_ELSE(g.hourCapHeight, FIXED_TO_INT(g.sunDiscRadius)*2));
-    fctx_set_rotation(&fctx, g.rotation.current);
-    for (int h = 0; h < 24; h += 6) {
-        FPoint c = clockPoint(fcenter, g.sunOrbitRadius, hourAngle(h) + g.rotation.current);
-        fctx_set_offset(&fctx, c);
-        snprintf(g.strbuf, ARRAY_LENGTH(g.strbuf), "%02d", h);
-        fctx_draw_string(&fctx, g.strbuf, g.font, GTextAlignmentCenter, FTextAnchorMiddle);
+    GRect bounds = layer_get_unobstructed_bounds(layer);
+    FPoint fcenter = g2fpoint(grect_center_point(&bounds));
+
+    GBitmap* fb = graphics_capture_frame_buffer(ctx);
+    if (!fb) {
+        return;
     }
-    fctx_end_fill(&fctx);
+
+    profileStart();
 
     /* Prep to draw the solar disc. */
-    uint32_t minute = g.gregorian.tm_hour * 60 + g.gregorian.tm_min;
-    FPoint sunPoint = clockPoint(fcenter, g.sunOrbitRadius, minuteAngle(minute) + g.rotation.current);
+    FPoint sunPoint = clock_point(fcenter, g.layout.sunOrbitRadius, minute_angle(g.sunMinute) + g.rotation.current);
+
+    /* Fill the solar disc, and stroke its perimeter as a ring on top.  The
+       fill is biased thinner at its edge, as it was with fctx, so that it
+       stays inside the ring drawn over it. */
+    span_set_coverage_bias(-3);
+    span_fill_ring(fb, sunPoint, g.layout.sunDiscRadius - g.layout.strokeWidth / 2, 0, g.colors[PaletteColorSolar]);
+    span_set_coverage_bias(0);
+    span_fill_ring(fb, sunPoint, g.layout.sunDiscRadius, g.layout.sunDiscRadius - g.layout.strokeWidth,
+                   g.colors[PaletteColorMarks]);
+
+    graphics_release_frame_buffer(ctx, fb);
+    profileEnd(ProfilePhaseSun);
+}
 
-    /* Fill the solar disc. */
-    fctx_begin_fill(&fctx);
-    fctx_set_fill_color(&fctx, g.colors[PaletteColorSolar]);
-    fctx_set_color_bias(&fctx, -3);
-    fctx_plot_circle(&fctx, &sunPoint, g.sunDiscRadius - g.strokeWidth / 2);
-    fctx_end_fill(&fctx);
-    fctx_set_color_bias(&fctx, 0);
+void drawReadoutLayer(Layer* layer, GContext* ctx) {
 
-    /* Stroke the solar disc perimeter. */
-    fctx_begin_fill(&fctx);
-    fctx_set_fill_color(&fctx, g.colors[PaletteColorMarks]);
-    fctx_plot_circle(&fctx, &sunPoint, g.sunDiscRadius);
-    fctx_plot_circle(&fctx, &sunPoint, g.sunDiscRadius - g.strokeWidth);
-    fctx_end_fill(&fctx);
+    benchPhase(BenchPhaseReadout);
 
-    /* Fill the readout background. */
-    fctx_begin_fill(&fctx);
-    fctx_set_fill_color(&fctx, g.colors[PaletteColorWithin]);
-    fctx_plot_circle(&fctx, &fcenter, g.readoutDiscRadius - g.strokeWidth / 2);
-    fctx_end_fill(&fctx);
+    if (!(g.frameDirty & DIRTY_READOUT)) {
+        return;
+    }
+
+    GRect bounds = layer_get_unobstructed_bounds(layer);
+    GPoint center = grect_center_point(&bounds);
+    FPoint fcenter = g2fpoint(center);
+
+    /* The readout and the text on it do not move while the dial animates,
+       so after the first frame they are blitted from a cache. */
+    if (g.animation && restoreReadout(ctx, bounds)) {
+        return;
+    }
+
+    GBitmap* fb = graphics_capture_frame_buffer(ctx);
+    if (!fb) {
+        return;
+    }
+
+    profileStart();
 
+    /* Fill the readout background. */
+    span_fill_ring(fb, fcenter, g.layout.readoutDiscRadius - g.layout.strokeWidth / 2, 0, g.colors[PaletteColorWithin]);
+    graphics_release_frame_buffer(ctx, fb);
+    profileEnd(ProfilePhaseReadout);
+
+    /* The dishes are paths, so they are still scan converted by fctx.
+       They go through a draw list, which fills same colored dishes that
+       do not overlap in one pass, such as the two engravings.  Heights
+       are negative for the bluetooth dish, which is flipped to the top. */
+    FContext fctx;
+    beginFContext(&fctx, ctx);
     fctx_set_rotation(&fctx, 0);
     fctx_set_offset(&fctx, fcenter);
 
+    DrawList dishes;
+    draw_list_init(&dishes);
+
     /* Draw the bluetooth state. */
     if (g.bluetoothAlert > 0) {
-        fctx_set_scale(&fctx, FPoint(1,1), FPoint(1,-1));
-
-        fctx_begin_fill(&fctx);
-        fctx_set_fill_color(&fctx, g.colors[PaletteColorEngraving]);
-        drawBatteryDish(&fctx, 13);
-        fctx_end_fill(&fctx);
-        fctx_begin_fill(&fctx);
-        fctx_set_fill_color(&fctx, g.colors[g.bluetooth ? PaletteColorOnline : PaletteColorOffline]);
-        drawBatteryDish(&fctx, 12);
-        fctx_end_fill(&fctx);
-
+        GColor state = g.colors[g.bluetooth ? PaletteColorOnline : PaletteColorOffline];
+        draw_list_add_path(&dishes, plotDish, -13, g.colors[PaletteColorEngraving], dishBounds(center, -13));
+        draw_list_add_path(&dishes, plotDish, -12, state, dishBounds(center, -12));
         if (!g.bluetooth) {
             GRect box;
             box.origin.x = center.x - 6;
-            box.origin.y = center.y - FIXED_TO_INT(g.readoutDiscRadius) + 6;
+            box.origin.y = center.y - FIXED_TO_INT(g.layout.readoutDiscRadius) + 6;
             box.size.w = 12;
             box.size.h = 3;
-            graphics_context_set_fill_color(fctx.gctx, g.colors[PaletteColorWithin]);
-            graphics_fill_rect(fctx.gctx, box, 0, 0);
+            draw_list_add_rect(&dishes, box, g.colors[PaletteColorWithin]);
         }
     }
 
     /* Draw the battery state. */
     if (g.batteryIndicator) {
-        fctx_set_scale(&fctx, FPointOne, FPointOne);
-        fctx_begin_fill(&fctx);
-        fctx_set_fill_color(&fctx, g.colors[PaletteColorEngraving]);
-        drawBatteryDish(&fctx, 13);
-        fctx_end_fill(&fctx);
+        draw_list_add_path(&dishes, plotDish, 13, g.colors[PaletteColorEngraving], dishBounds(center, 13));
         if (g.battery < 10) {
-            fctx_begin_fill(&fctx);
-            fctx_set_fill_color(&fctx, g.colors[PaletteColorCapacity]);
-            drawBatteryDish(&fctx, 12);
-            fctx_end_fill(&fctx);
+            draw_list_add_path(&dishes, plotDish, 12, g.colors[PaletteColorCapacity], dishBounds(center, 12));
         }
-        fctx_begin_fill(&fctx);
-        fctx_set_fill_color(&fctx, g.colors[PaletteColorCharge]);
-        drawBatteryDish(&fctx, 2 + g.battery);
-        fctx_end_fill(&fctx);
+        draw_list_add_path(&dishes, plotDish, 2 + g.battery, g.colors[PaletteColorCharge],
+                           dishBounds(center, 2 + g.battery));
     }
 
+    draw_list_flush(&dishes, &fctx);
+#if DRAW_LIST_DEBUG
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "dishes: %d fill passes merged into %d",
+            dishes.passesRecorded, dishes.passesDrawn);
+#endif
+
+    endFContext(&fctx);
+    profileEnd(ProfilePhaseDishes);
+
     /* Stroke around the readout perimeter. */
-    fctx_begin_fill(&fctx);
-    fctx_set_fill_color(&fctx, g.colors[PaletteColorMarks]);
-    fctx_plot_circle(&fctx, &fcenter, g.readoutDiscRadius);
-    fctx_plot_circle(&fctx, &fcenter, g.readoutDiscRadius - g.strokeWidth);
-    fctx_end_fill(&fctx);
+    fb = graphics_capture_frame_buffer(ctx);
+    if (fb) {
+        span_fill_ring(fb, fcenter, g.layout.readoutDiscRadius, g.layout.readoutDiscRadius - g.layout.strokeWidth,
+                       g.colors[PaletteColorMarks]);
+        graphics_release_frame_buffer(ctx, fb);
+    }
+    profileEnd(ProfilePhaseStroke);
+}
+
+void drawTextLayer(Layer* layer, GContext* ctx) {
+
+    benchPhase(BenchPhaseText);
+
+    if (!(g.frameDirty & DIRTY_READOUT)) {
+        drawTextDone();
+        return;
+    }
+
+    GRect bounds = layer_get_unobstructed_bounds(layer);
+    FPoint fcenter = g2fpoint(grect_center_point(&bounds));
+
+    if (g.animation && g.readoutValid) {
+        drawTextDone();
+        return;
+    }
+
+    FContext fctx;
+    beginFContext(&fctx, ctx);
+
+    profileStart();
 
     FPoint p;
     fctx_begin_fill(&fctx);
@@ -659,183 +1173,1100 @@ void drawClock(Layer* layer, GContext* ctx) {
     fctx_set_fill_color(&fctx, g.colors[PaletteColorText]);
     graphics_context_set_text_color(ctx, g.colors[PaletteColorText]);
 
-    /* Draw the time string. */
-    formatTime();
+    /* Draw the time string, blitting the pre-rasterized digits when they
+       were built for this size, or at any size in a draft frame.  Draft
+       frames also set the weekday and date in a system font, so that they
+       draw no antialiased text at all. */
+    bool draft = g.quality == QualityDraft;
+    SystemFont* dateFont = g.dateFont ? g.dateFont : draft ? &Gothic18Bold : NULL;
+    updateText();
+    int16_t atlasCapHeight = g.digits ? digit_atlas_get_cap_height(g.digits) : 0;
     p.x = fcenter.x;
-    p.y = fcenter.y + INT_TO_FIXED(g.timeCapHeight / 2);
-    fctx_set_offset(&fctx, p);
-    fctx_set_text_cap_height(&fctx, g.font, g.timeCapHeight);
-    fctx_draw_string(&fctx, g.strbuf, g.font, GTextAlignmentCenter, FTextAnchorBaseline);
+    p.y = fcenter.y + INT_TO_FIXED((draft && g.digits ? atlasCapHeight : g.layout.timeCapHeight) / 2);
+    if (!g.digits || (!draft && atlasCapHeight != g.layout.timeCapHeight)
+        || !digit_atlas_draw_string(g.digits, ctx, g.timeText.text, p, GTextAlignmentCenter, g.colors[PaletteColorText])) {
+        p.y = fcenter.y + INT_TO_FIXED(g.layout.timeCapHeight / 2);
+        fctx_set_offset(&fctx, p);
+        fctx_set_text_cap_height(&fctx, g.font, g.layout.timeCapHeight);
+        fctx_draw_string(&fctx, g.timeText.text, g.font, GTextAlignmentCenter, FTextAnchorBaseline);
+    }
 
     /* Draw the weekday text. */
-    strftime(g.strbuf, ARRAY_LENGTH(g.strbuf), kWeekdayFormat, &g.gregorian);
-    utf8_str_to_upper(g.strbuf);
-    p.y = fcenter.y - INT_TO_FIXED(g.timeCapHeight / 2) - g.dateTextGap;
+    p.y = fcenter.y - INT_TO_FIXED(g.layout.timeCapHeight / 2) - g.layout.dateTextGap;
     fctx_set_offset(&fctx, p);
-    if (g.dateFont) {
-        gctx_draw_string(&fctx, g.strbuf, g.dateFont, GTextAlignmentCenter, FTextAnchorBaseline);
+    if (dateFont) {
+        gctx_draw_string(&fctx, g.weekdayText.text, dateFont, GTextAlignmentCenter, FTextAnchorBaseline,
+                         &g.weekdayText.width);
     } else {
-        fctx_set_text_cap_height(&fctx, g.font, g.dateCapHeight);
-        fctx_draw_string(&fctx, g.strbuf, g.font, GTextAlignmentCenter, FTextAnchorBaseline);
+        fctx_set_text_cap_height(&fctx, g.font, g.layout.dateCapHeight);
+        fctx_draw_string(&fctx, g.weekdayText.text, g.font, GTextAlignmentCenter, FTextAnchorBaseline);
     }
 
     /* Draw the date text. */
-    strftime(g.strbuf, ARRAY_LENGTH(g.strbuf), kDateFormat, &g.gregorian);
-    utf8_str_to_upper(g.strbuf);
-    p.y = fcenter.y + INT_TO_FIXED(g.timeCapHeight / 2) + g.dateTextGap;
+    p.y = fcenter.y + INT_TO_FIXED(g.layout.timeCapHeight / 2) + g.layout.dateTextGap;
     fctx_set_offset(&fctx, p);
-    if (g.dateFont) {
-        gctx_draw_string(&fctx, g.strbuf, g.dateFont, GTextAlignmentCenter, FTextAnchorCapTop);
+    if (dateFont) {
+        gctx_draw_string(&fctx, g.dateText.text, dateFont, GTextAlignmentCenter, FTextAnchorCapTop,
+                         &g.dateText.width);
     } else {
-        fctx_set_text_cap_height(&fctx, g.font, g.dateCapHeight);
-        fctx_draw_string(&fctx, g.strbuf, g.font, GTextAlignmentCenter, FTextAnchorCapTop);
+        fctx_set_text_cap_height(&fctx, g.font, g.layout.dateCapHeight);
+        fctx_draw_string(&fctx, g.dateText.text, g.font, GTextAlignmentCenter, FTextAnchorCapTop);
     }
 
     fctx_end_fill(&fctx);
+    profileEnd(ProfilePhaseText);
 
-    fctx_deinit_context(&fctx);
-
-}
-
-static inline FPoint batteryPoint(int k, fixed_t side) {
-    FPoint pt;
-    pt.x = g.battery_x[k] * side;
-    pt.y = g.readoutDiscRadius - g.strokeWidth / 2 - INT_TO_FIXED(k);
-    return pt;
-}
+    endFContext(&fctx);
 
-static void drawBatteryDish(FContext* fctx, int height) {
-    int top = height - 1;
-    int k = top;
-    fctx_move_to(fctx, batteryPoint(k--, -1));
-    while (k >= 0) {
-        fctx_line_to(fctx, batteryPoint(k--, -1));
-    }
-    while (k <= top) {
-        fctx_line_to(fctx, batteryPoint(k++, +1));
+    if (g.animation) {
+        captureReadout(ctx, bounds);
     }
-    fctx_close_path(fctx);
+    drawTextDone();
 }
 
-// --------------------------------------------------------------------------
-
-// --------------------------------------------------------------------------
-
-static void timeChanged(struct tm* gregorian, TimeUnits unitsChanged) {
-    g.gregorian = *gregorian;
-    if (unitsChanged & MINUTE_UNIT) {
-        layer_mark_dirty(g.layer);
-    }
-    if (unitsChanged & DAY_UNIT) {
-        configureClock();
-        animateClock();
+/* The text layer is the last to draw, so this closes the frame. */
+static void drawTextDone() {
+    if (g.animation && g.framePending) {
+        ++g.framesRendered;
+        telemetryAdd(TelemetryAnimationFrames, 1);
     }
+    g.framePending = false;
+    ++g.counters.frames;
+    g.frameDirty = 0;
+    g.frameRequested = false;
+    uint32_t elapsed = clockMillis() - g.qualityFrameStart;
+    QualityStats* stats = &g.qualityStats[g.quality];
+    ++stats->frames;
+    stats->millis += elapsed;
+    telemetryAdd(TelemetryDrawMillis, elapsed);
+    heapSample();
+    screenshotFrameDone();
+    benchFrameDone();
 }
 
-static void bluetoothConnected(bool connected) {
-    g.bluetooth = connected;
-    layer_mark_dirty(g.layer);
+/* Rows covered by the marking for hour h, with a row of margin for the
+   antialiasing.  The labels may be rotated, so allow for their corners. */
+static inline int16_t labelCapHeight() {
+    return PBL_IF_COLOR_ELSE(g.layout.hourCapHeight, FIXED_TO_INT(g.layout.sunDiscRadius) * 2);
 }
 
-static void batteryStateChanged(BatteryChargeState charge) {
-    g.battery = (charge.charge_percent + 5) / 10;
-    layer_mark_dirty(g.layer);
+static inline void markingRows(FPoint c, int h, int16_t* top, int16_t* bottom) {
+    fixed_t r = (h % 6) ? g.layout.hourPipRadius : g.layout.sunDiscRadius * 3 / 2;
+    *top = FIXED_TO_INT(c.y - r) - 1;
+    *bottom = FIXED_TO_INT(c.y + r) + 2;
 }
 
-// ---------------------------------------------------------------------------
-//
-// ---------------------------------------------------------------------------
-
-static void messageReceived(DictionaryIterator* received, void* context) {
-
-    Tuple* tuple;
-
-    tuple = dict_find(received, MESSAGE_KEY_BATTERY);
-    if (tuple) {
-        g.batteryIndicator = tuple->value->int16 != 0;
-        persist_write_bool(PersistKeyBattery, g.batteryIndicator);
-        layer_mark_dirty(g.layer);
-    }
+/* Draw everything behind the solar disc: the background, the horizon
+   and the solar orbit markings.  Only the rows from top to bottom are
+   painted, along with every marking that reaches into them. */
+static void drawDial(FContext* fctx, GRect bounds, int16_t top, int16_t bottom) {
 
-    tuple = dict_find(received, MESSAGE_KEY_BLUETOOTH);
-    if (tuple) {
-        g.bluetoothAlert = tuple->value->int32;
-        persist_write_int(PersistKeyBattery, g.bluetoothAlert);
-        layer_mark_dirty(g.layer);
-    }
-
-    tuple = dict_find(received, MESSAGE_KEY_PALETTE);
-    if (tuple && TUPLE_BYTE_ARRAY == tuple->type) {
-        int length = (tuple->length < PaletteSize) ? tuple->length : PaletteSize;
-        persist_write_data(PersistKeyPalette, tuple->value->data, length);
-        applyPalette(tuple->value->data, length);
-        layer_mark_dirty(g.layer);
+    GContext* ctx = fctx->gctx;
+    GPoint center = grect_center_point(&bounds);
+    FPoint fcenter = g2fpoint(center);
+    int16_t aboveLine = center.y + g.above.current - 1;
+    int16_t belowLine = center.y + g.below.current;
+
+    /* While the rotation animates, every frame is drawn in full, and the
+       labels are drawn from masks rasterized on the first frame. */
+    bool rotating = g.animation && g.rotation.from != g.rotation.to;
+    if (rotating && !g.labelMasks[0]
+        && top == bounds.origin.y && bottom == bounds.origin.y + bounds.size.h) {
+        buildLabelMasks(fctx, bounds);
     }
 
-    tuple = dict_find(received, MESSAGE_KEY_TIMEZONE);
-    if (tuple) {
-        g.location.timezone = tuple->value->int32;
-        persist_write_int(PersistKeyTimezone,  g.location.timezone);
+    GBitmap* fb = graphics_capture_frame_buffer(ctx);
+    if (!fb) {
+        return;
     }
 
-    tuple = dict_find(received, MESSAGE_KEY_LONGITUDE);
-    if (tuple) {
-        g.location.longitude = tuple->value->int32;
-        persist_write_int(PersistKeyLongitude, g.location.longitude);
+    profileStart();
+
+    /* Fill the background as horizontal bands, top to bottom, so that
+       each row is written once: above the horizon, the upper horizon
+       line, behind everything, the lower horizon line, and below. */
+    GRect band = GRect(bounds.origin.x, top, bounds.size.w, 0);
+    int16_t edges[] = { aboveLine, aboveLine + 1, belowLine, belowLine + 1, bottom };
+    GColor colors[] = {
+        g.colors[PaletteColorAbove],
+        g.colors[PaletteColorMarks],
+        g.colors[PaletteColorBehind],
+        g.colors[PaletteColorMarks],
+        g.colors[PaletteColorBelow],
+    };
+    for (uint32_t k = 0; k < ARRAY_LENGTH(edges); ++k) {
+        int16_t end = maxInt16(band.origin.y, minInt16(edges[k], bottom));
+        band.size.h = end - band.origin.y;
+        span_fill_rect(fb, band, colors[k]);
+        band.origin.y = end;
     }
 
-    tuple = dict_find(received, MESSAGE_KEY_LATITUDE);
-    if (tuple) {
-        g.location.latitude = tuple->value->int32;
-        persist_write_int(PersistKeyLatitude,  g.location.latitude);
-    }
+    profileEnd(ProfilePhaseBackground);
 
-    tuple = dict_find(received, MESSAGE_KEY_SUNRISE);
-    if (tuple) {
-        g.location.sunrise = tuple->value->int32;
-        persist_write_int(PersistKeySunrise,   g.location.sunrise);
-    }
+    /* Draw the solar orbit markings. */
+    FPoint hours[24];
+    hourPoints(fcenter, hours);
+    int16_t markTop, markBottom;
+    for (int h = 0; h < 24; ++h) {
+        markingRows(hours[h], h, &markTop, &markBottom);
+        if (markBottom <= top || markTop >= bottom) {
+            continue;
+        }
+        FPoint c = hours[h];
+        if (h % 6) {
+            span_fill_ring(fb, c, g.layout.hourPipRadius, 0, g.colors[PaletteColorMarks]);
+#ifdef PBL_COLOR
+        } else {
+            span_fill_ring(fb, c, g.layout.sunDiscRadius, 0, g.colors[PaletteColorMarks]);
+#endif
+        }
+    }
+    profileEnd(ProfilePhasePips);
+
+    GColor labelColor = g.colors[PBL_IF_COLOR_ELSE(PaletteColorSolar, PaletteColorMarks)];
+    if (rotating && g.labelMasks[0]) {
+        for (int h = 0; h < 24; h += 6) {
+            markingRows(hours[h], h, &markTop, &markBottom);
+            if (markBottom <= top || markTop >= bottom) {
+                continue;
+            }
+            span_draw_mask(fb, g.labelMasks[h / 6], hours[h], g.rotation.current, labelColor);
+        }
+        graphics_release_frame_buffer(ctx, fb);
+        profileEnd(ProfilePhaseLabels);
+        return;
+    }
+    graphics_release_frame_buffer(ctx, fb);
+
+    fctx_begin_fill(fctx);
+    fctx_set_fill_color(fctx, labelColor);
+    fctx_set_text_cap_height(fctx, g.font, labelCapHeight());
+    fctx_set_rotation(fctx, g.rotation.current);
+    for (int h = 0; h < 24; h += 6) {
+        markingRows(hours[h], h, &markTop, &markBottom);
+        if (markBottom <= top || markTop >= bottom) {
+            continue;
+        }
+        fctx_set_offset(fctx, hours[h]);
+        fctx_draw_string(fctx, kHourLabels[h / 6], g.font, GTextAlignmentCenter, FTextAnchorMiddle);
+    }
+    fctx_end_fill(fctx);
+    profileEnd(ProfilePhaseLabels);
+}
+
+/* Rasterize the four hour labels once, unrotated and white on black, in
+   a row of cells across the middle of the screen, and keep what they
+   cover as masks.  The dial is painted over the cells straight after.
+   The masks are only made if the heap can spare them with some margin
+   left over. */
+static void buildLabelMasks(FContext* fctx, GRect bounds) {
+    GContext* ctx = fctx->gctx;
+    int16_t cell = 2 * FIXED_TO_INT(g.layout.sunDiscRadius * 3 / 2) + 2;
+    if (heap_bytes_free() < ARRAY_LENGTH(g.labelMasks) * (sizeof(SpanMask) + cell * cell) + DIAL_HEAP_MARGIN) {
+        return;
+    }
+    GPoint center = grect_center_point(&bounds);
+    GRect cells = GRect(center.x - 2 * cell, center.y - cell / 2, 4 * cell, cell);
+
+    GBitmap* fb = graphics_capture_frame_buffer(ctx);
+    if (!fb) {
+        return;
+    }
+    span_fill_rect(fb, cells, GColorBlack);
+    graphics_release_frame_buffer(ctx, fb);
+
+    fctx_begin_fill(fctx);
+    fctx_set_fill_color(fctx, GColorWhite);
+    fctx_set_text_cap_height(fctx, g.font, labelCapHeight());
+    fctx_set_rotation(fctx, 0);
+    for (uint32_t k = 0; k < ARRAY_LENGTH(g.labelMasks); ++k) {
+        fctx_set_offset(fctx, FPoint(INT_TO_FIXED(cells.origin.x + k * cell) + cell * FIXED_POINT_SCALE / 2,
+                                     INT_TO_FIXED(cells.origin.y) + cell * FIXED_POINT_SCALE / 2));
+        fctx_draw_string(fctx, kHourLabels[k], g.font, GTextAlignmentCenter, FTextAnchorMiddle);
+    }
+    fctx_end_fill(fctx);
+
+    fb = graphics_capture_frame_buffer(ctx);
+    if (!fb) {
+        return;
+    }
+    for (uint32_t k = 0; k < ARRAY_LENGTH(g.labelMasks); ++k) {
+        g.labelMasks[k] = span_mask_capture(fb, GRect(cells.origin.x + k * cell, cells.origin.y, cell, cell));
+        if (!g.labelMasks[k]) {
+            freeLabelMasks();
+            break;
+        }
+    }
+    graphics_release_frame_buffer(ctx, fb);
+}
+
+static void freeLabelMasks() {
+    for (uint32_t k = 0; k < ARRAY_LENGTH(g.labelMasks); ++k) {
+        free(g.labelMasks[k]);
+        g.labelMasks[k] = NULL;
+    }
+}
+
+// --------------------------------------------------------------------------
+// fctx arena.
+// --------------------------------------------------------------------------
+
+/* fctx_init_context allocates a frame sized flag buffer, and
+   fctx_deinit_context frees it, so a context per draw churns the heap on
+   every frame.  Instead the face initializes one context on its first
+   draw, before any cache is allocated, and every draw starts from a copy
+   of it.  fctx leaves the flag buffer clear after each fill, so it can be
+   shared.  If the arena cannot be allocated, draws fall back to a context
+   of their own. */
+static void beginFContext(FContext* fctx, GContext* ctx) {
+    if (!g.fctxArenaReady) {
+        fctx_init_context(&g.fctxArena, ctx);
+        g.fctxArenaReady = g.fctxArena.flag_buffer != NULL;
+    }
+    if (g.fctxArenaReady) {
+        *fctx = g.fctxArena;
+        fctx->gctx = ctx;
+    } else {
+        fctx_init_context(fctx, ctx);
+    }
+}
+
+static void endFContext(FContext* fctx) {
+    if (!g.fctxArenaReady || fctx->flag_buffer != g.fctxArena.flag_buffer) {
+        fctx_deinit_context(fctx);
+    }
+}
+
+#if HEAP_DEBUG
+/* Track the heap around each frame, and log each new high water mark. */
+static void heapSample() {
+    static size_t maxUsed = 0;
+    static size_t minFree = SIZE_MAX;
+    size_t used = heap_bytes_used();
+    size_t available = heap_bytes_free();
+    if (used > maxUsed || available < minFree) {
+        maxUsed = (used > maxUsed) ? used : maxUsed;
+        minFree = (available < minFree) ? available : minFree;
+        APP_LOG(APP_LOG_LEVEL_DEBUG, "heap: %u bytes used at most, %u free at least",
+                (unsigned)maxUsed, (unsigned)minFree);
+    }
+}
+#endif
+
+// --------------------------------------------------------------------------
+// Redraw scheduling.
+// --------------------------------------------------------------------------
+
+/* Record what changed, and redraw once for all the events handled in
+   this pass of the event loop. */
+static void flushRedraw(void* context) {
+    g.redrawTimer = NULL;
+    uint8_t dirty = g.dirty;
+    g.dirty = 0;
+    if (dirty & (DirtyPalette | DirtyLayout | DirtyDial)) {
+        invalidateDial();
+    }
+    if (dirty & (DirtyTime | DirtySun | DirtyPalette | DirtyLayout | DirtyDial | DirtyDishes)) {
+        invalidateReadout();
+    }
+    g.frameDirty |= dirty;
+    g.frameRequested = true;
+    layer_mark_dirty(g.dialLayer);
+}
+
+static void scheduleRedraw(uint8_t dirty) {
+    g.dirty |= dirty;
+    if (!g.redrawTimer) {
+        g.redrawTimer = app_timer_register(0, flushRedraw, NULL);
+    }
+}
+
+/* The framebuffer may have been overwritten while the face was away. */
+static void windowAppeared(Window* window) {
+    g.frameDirty |= DirtyFrame;
+}
+
+static void focusChanged(bool inFocus) {
+    if (inFocus) {
+        markClockDirty();
+    }
+}
+
+// --------------------------------------------------------------------------
+// Render quality.
+// --------------------------------------------------------------------------
+
+/* The policy may ask for draft quality all the time.  fctx and the span
+   fills each have a global antialiasing switch, and both follow the
+   quality. */
+static void updateQuality() {
+    bool draft = g.animation || g.sliding || (g.policy && g.policy->quality == QualityDraft);
+    g.quality = draft ? QualityDraft : QualityFull;
+#ifdef PBL_COLOR
+    fctx_enable_aa(g.quality == QualityFull);
+#endif
+    span_enable_aa(g.quality == QualityFull);
+}
+
+/* Log the mean cost of a frame in each quality, so far. */
+static void logQuality() {
+    static const char* kQualityNames[QualityCount] = { "full", "draft" };
+    for (int k = 0; k < QualityCount; ++k) {
+        QualityStats* stats = &g.qualityStats[k];
+        if (stats->frames) {
+            uint32_t mean = stats->millis * 100 / stats->frames;
+            APP_LOG(APP_LOG_LEVEL_DEBUG, "quality %s: %d frames, %lu.%02lu ms/frame",
+                    kQualityNames[k], stats->frames, mean / 100, mean % 100);
+        }
+    }
+}
+
+// --------------------------------------------------------------------------
+// Tick policy.
+// --------------------------------------------------------------------------
+
+/* The first row whose conditions all hold is the policy.  The face always
+   ticks by the minute, because the readout shows the minute, so the
+   savings come from stepping the sun less often, which leaves the dial
+   and the sun to the cache on the minutes in between, from jumping
+   instead of animating when the horizon moves, and from drawing without
+   antialiasing. */
+static const TickPolicy kTickPolicies[] = {
+    { PolicyAwake, 1, true, QualityFull, "awake" },
+    { PolicyLowBattery, 15, false, QualityDraft, "low battery" },
+    { PolicyNight | PolicyOffline, 15, false, QualityDraft, "night offline" },
+    { PolicyNight, 5, false, QualityFull, "night" },
+    { 0, 1, true, QualityFull, "day" },
+};
+
+/* Whether the sun is below the horizon now, by today's sun events.
+   Without a location, it is never night. */
+static bool isNight() {
+    if (0 == g.location.timestamp) {
+        return false;
+    }
+    if (g.location.sunstat != 0) {
+        return g.location.sunstat < 0;
+    }
+    int32_t day = 24 * 60;
+    int32_t minute = g.gregorian.tm_hour * 60 + g.gregorian.tm_min;
+    int32_t rise = ((g.location.sunrise + g.location.timezone) % day + day) % day;
+    int32_t set = ((g.location.sunset + g.location.timezone) % day + day) % day;
+    if (rise < set) {
+        return minute < rise || minute >= set;
+    }
+    return minute >= set && minute < rise;
+}
+
+static uint8_t policyConditions() {
+    uint8_t conditions = 0;
+    if (g.wakeTime && time(NULL) - g.wakeTime < POLICY_WAKE_MINUTES * 60) {
+        conditions |= PolicyAwake;
+    }
+    if (g.battery <= POLICY_LOW_BATTERY && !g.charging) {
+        conditions |= PolicyLowBattery;
+    }
+    if (isNight()) {
+        conditions |= PolicyNight;
+    }
+    if (!g.bluetooth) {
+        conditions |= PolicyOffline;
+    }
+    return conditions;
+}
+
+/* Choose the policy for the current conditions.  On a change, log what
+   the last one did, and bring the sun and the quality up to date.
+   Returns true on a change, so that the caller need not step the sun
+   again. */
+static bool applyPolicy() {
+    uint8_t conditions = policyConditions();
+    const TickPolicy* policy = &kTickPolicies[ARRAY_LENGTH(kTickPolicies) - 1];
+    for (size_t k = 0; k < ARRAY_LENGTH(kTickPolicies); ++k) {
+        if ((conditions & kTickPolicies[k].conditions) == kTickPolicies[k].conditions) {
+            policy = &kTickPolicies[k];
+            break;
+        }
+    }
+    if (policy == g.policy) {
+        return false;
+    }
+
+    if (g.policy) {
+        APP_LOG(APP_LOG_LEVEL_DEBUG, "policy %s: %d ticks, %d frames, %d sun steps, %d held",
+                g.policy->name, g.counters.ticks, g.counters.frames,
+                g.counters.sunSteps, g.counters.sunStepsHeld);
+        APP_LOG(APP_LOG_LEVEL_DEBUG, "policy %s: skipped %d dial and %d sun redraws, %d animations of %d frames",
+                g.policy->name, g.counters.dialSkipped, g.counters.sunSkipped,
+                g.counters.animationsSkipped, g.counters.animationFramesSkipped);
+    }
+    bool requality = g.policy && policy->quality != g.policy->quality;
+    memset(&g.counters, 0, sizeof(g.counters));
+    g.policy = policy;
+    stepSun();
+    updateQuality();
+    if (requality) {
+        /* The cached dial was drawn in the old quality. */
+        scheduleRedraw(DirtyDial);
+    }
+    return true;
+}
+
+/* Move the sun to the current minute, rounded down to the policy step. */
+static void stepSun() {
+    uint16_t minute = g.gregorian.tm_hour * 60 + g.gregorian.tm_min;
+    minute -= minute % g.policy->sunStep;
+    if (minute == g.sunMinute) {
+        ++g.counters.sunStepsHeld;
+        return;
+    }
+    ++g.counters.sunSteps;
+    g.sunMinute = minute;
+    scheduleRedraw(DirtySun);
+}
+
+// --------------------------------------------------------------------------
+// Layout.
+// --------------------------------------------------------------------------
+
+/* Compute the layout that fits the face into an area of the given size.
+   The full screen layout comes precomputed in kFullLayout, so this only
+   runs for obstructed sizes, and tools/layout-tables.py must follow any
+   change to it. */
+static void computeLayout(Layout* layout, GSize size) {
+
+    if (gsize_equal(&size, &kFullLayout.size)) {
+        *layout = kFullLayout;
+        return;
+    }
+
+    layout->size = size;
+
+    int16_t designRadius = sizeInner(size) / 2 - PBL_IF_ROUND_ELSE(4, 0);                      // 72
+    layout->sunDiscRadius = designRadius * 3 / 25;                                            // 8
+    layout->hourCapHeight = layout->sunDiscRadius * 25 / 17;                                  // 11
+    int16_t sunDiscMargin = layout->sunDiscRadius * 1 / 3;                                    // 2
+    layout->sunOrbitRadius = designRadius - sunDiscMargin - layout->sunDiscRadius;            // 62
+    layout->readoutDiscRadius = layout->sunOrbitRadius - layout->sunDiscRadius - sunDiscMargin; // 52
+    layout->timeCapHeight = (layout->readoutDiscRadius * 10 / 21) / 2 * 2;                    // 24
+    layout->dateCapHeight = layout->readoutDiscRadius * 3 / 11;                               // 14
+    layout->dateTextGap = layout->readoutDiscRadius * 4 / 50;                                 // 4
+    layout->strokeWidth = 2;
+
+    arc_chords(layout->readoutDiscRadius - layout->strokeWidth / 2,
+               ARRAY_LENGTH(layout->battery_x), layout->battery_x);
+
+    layout->sunDiscRadius *= FIXED_POINT_SCALE;
+    layout->sunOrbitRadius *= FIXED_POINT_SCALE;
+    layout->readoutDiscRadius *= FIXED_POINT_SCALE;
+    layout->dateTextGap *= FIXED_POINT_SCALE;
+    layout->strokeWidth *= FIXED_POINT_SCALE;
+
+    layout->hourPipRadius = layout->sunDiscRadius * 1 / 4;
+}
+
+static inline fixed_t lerpFixed(fixed_t from, fixed_t to, int32_t t) {
+    return from + (to - from) * t / ANIMATION_NORMALIZED_MAX;
+}
+
+/* Set the current layout for an unobstructed area of the given size.  In
+   between the full and the obstructed size, as during the Quick View
+   slide, the geometry is blended from the two cached layouts, while the
+   text keeps the sizes of the nearer one, so nothing is recomputed and
+   no text is reflowed on each step. */
+static void applyLayout(GSize size) {
+
+    const Layout* full = &kFullLayout;
+    const Layout* obstructed = &g.obstructedLayout;
+    int16_t span = full->size.h - obstructed->size.h;
+
+    if (gsize_equal(&size, &full->size) || span <= 0) {
+        g.layout = *full;
+    } else if (gsize_equal(&size, &obstructed->size)) {
+        g.layout = *obstructed;
+    } else {
+        int32_t t = (full->size.h - size.h) * ANIMATION_NORMALIZED_MAX / span;
+        t = (t < 0) ? 0 : (t > ANIMATION_NORMALIZED_MAX) ? ANIMATION_NORMALIZED_MAX : t;
+        const Layout* nearer = (t < ANIMATION_NORMALIZED_MAX / 2) ? full : obstructed;
+        g.layout = *nearer;
+        g.layout.size = size;
+        g.layout.sunDiscRadius = lerpFixed(full->sunDiscRadius, obstructed->sunDiscRadius, t);
+        g.layout.hourPipRadius = lerpFixed(full->hourPipRadius, obstructed->hourPipRadius, t);
+        g.layout.sunOrbitRadius = lerpFixed(full->sunOrbitRadius, obstructed->sunOrbitRadius, t);
+        g.layout.readoutDiscRadius = lerpFixed(full->readoutDiscRadius, obstructed->readoutDiscRadius, t);
+        g.layout.dateTextGap = lerpFixed(full->dateTextGap, obstructed->dateTextGap, t);
+        g.layout.strokeWidth = lerpFixed(full->strokeWidth, obstructed->strokeWidth, t);
+        for (uint32_t k = 0; k < ARRAY_LENGTH(g.layout.battery_x); ++k) {
+            g.layout.battery_x[k] = lerpFixed(full->battery_x[k], obstructed->battery_x[k], t);
+        }
+    }
+
+    /* The horizon is measured along the sun orbit, so it moves with the
+       layout, without animation.  The sun events stay as they are.  A
+       running animation is retargeted, so that it ends on the horizon of
+       the new layout. */
+    freeLabelMasks();
+    positionClock();
+    if (g.animation) {
+        g.above.to = g.horizon;
+        g.below.to = g.horizon;
+    } else if (g.location.timestamp) {
+        g.above.current = g.horizon;
+        g.below.current = g.horizon;
+    }
+    scheduleRedraw(DirtyLayout);
+}
+
+// --------------------------------------------------------------------------
+// Retained dial.
+// --------------------------------------------------------------------------
+
+/* Copy the framebuffer to (save) or from (restore) a packed buffer and
+   return the number of bytes transferred.  With a NULL buffer nothing is
+   copied, which gives the buffer size.  Rows are stored back to back, so
+   on round displays only the visible part of each row is kept. */
+static size_t transferFrame(GBitmap* fb, uint8_t* buffer, bool save) {
+    GRect bounds = gbitmap_get_bounds(fb);
+    size_t offset = 0;
+#if defined(PBL_BW)
+    size_t length = gbitmap_get_bytes_per_row(fb) * bounds.size.h;
+    if (buffer) {
+        uint8_t* data = gbitmap_get_data(fb);
+        memcpy(save ? buffer : data, save ? data : buffer, length);
+    }
+    offset = length;
+#else
+    for (int16_t y = 0; y < bounds.size.h; ++y) {
+        GBitmapDataRowInfo row = gbitmap_get_data_row_info(fb, y);
+        size_t length = row.max_x - row.min_x + 1;
+        if (buffer) {
+            uint8_t* data = row.data + row.min_x;
+            memcpy(save ? buffer + offset : data, save ? data : buffer + offset, length);
+        }
+        offset += length;
+    }
+#endif
+    return offset;
+}
+
+static void invalidateDial() {
+    g.dialValid = false;
+}
+
+/* Blit the cached dial into the framebuffer.  Returns false if the cache
+   does not hold a dial for these bounds. */
+static bool restoreDial(GContext* ctx, GRect bounds) {
+    if (!g.dialValid || !grect_equal(&bounds, &g.dialBounds)) {
+        return false;
+    }
+    GBitmap* fb = graphics_capture_frame_buffer(ctx);
+    if (!fb) {
+        return false;
+    }
+    transferFrame(fb, g.dialCache, false);
+    graphics_release_frame_buffer(ctx, fb);
+    return true;
+}
+
+/* Blit the disc under the readout, with a pixel of margin for its
+   antialiasing, from the cached dial.  The sun stays clear of it.
+   Returns false if the cache does not hold a dial for these bounds. */
+static bool restoreReadoutArea(GContext* ctx, GRect bounds) {
+    if (!g.dialValid || !grect_equal(&bounds, &g.dialBounds)) {
+        return false;
+    }
+    GBitmap* fb = graphics_capture_frame_buffer(ctx);
+    if (!fb) {
+        return false;
+    }
+    GPoint center = grect_center_point(&bounds);
+    int32_t radius = FIXED_TO_INT(g.layout.readoutDiscRadius + FIXED_POINT_SCALE - 1) + 1;
+    GRect frame = gbitmap_get_bounds(fb);
+#if defined(PBL_BW)
+    uint16_t stride = gbitmap_get_bytes_per_row(fb);
+#else
+    size_t offset = 0;
+#endif
+    for (int16_t y = 0; y < frame.size.h; ++y) {
+#if !defined(PBL_BW)
+        GBitmapDataRowInfo row = gbitmap_get_data_row_info(fb, y);
+        size_t length = row.max_x - row.min_x + 1;
+        offset += length;
+#endif
+        int32_t dy = y - center.y;
+        if (dy < -radius || dy > radius) {
+            continue;
+        }
+        int16_t half = usqrt(radius * radius - dy * dy) >> SQRT_SHIFT;
+        int16_t x0 = center.x - half;
+        int16_t x1 = center.x + half;
+#if defined(PBL_BW)
+        /* One bit a pixel, least significant first. */
+        x0 = maxInt16(x0, 0);
+        x1 = minInt16(x1, frame.size.w - 1);
+        uint8_t* data = gbitmap_get_data(fb) + y * stride;
+        const uint8_t* saved = g.dialCache + y * stride;
+        for (int16_t b = x0 >> 3; b <= x1 >> 3; ++b) {
+            uint8_t mask = 0xff;
+            if (b == x0 >> 3) mask &= 0xff << (x0 & 7);
+            if (b == x1 >> 3) mask &= 0xff >> (7 - (x1 & 7));
+            data[b] = (data[b] & ~mask) | (saved[b] & mask);
+        }
+#else
+        x0 = maxInt16(x0, row.min_x);
+        x1 = minInt16(x1, row.max_x);
+        if (x0 <= x1) {
+            memcpy(row.data + x0, g.dialCache + offset - length + (x0 - row.min_x), x1 - x0 + 1);
+        }
+#endif
+    }
+    graphics_release_frame_buffer(ctx, fb);
+    return true;
+}
+
+/* Save the freshly drawn dial.  This is skipped while the rotation
+   animates, since then the whole dial changes on every frame.  The cache
+   is allocated on first use, after the fctx arena, and only if the heap
+   can spare it with some margin left over. */
+static void captureDial(GContext* ctx, GRect bounds) {
+    if (g.animation && g.rotation.from != g.rotation.to) {
+        return;
+    }
+    GBitmap* fb = graphics_capture_frame_buffer(ctx);
+    if (!fb) {
+        return;
+    }
+    if (!g.dialCache) {
+        size_t size = transferFrame(fb, NULL, true);
+        if (heap_bytes_free() >= size + DIAL_HEAP_MARGIN) {
+            g.dialCache = malloc(size);
+        }
+    }
+    if (g.dialCache) {
+        transferFrame(fb, g.dialCache, true);
+        g.dialBounds = bounds;
+        g.dialAbove = g.above.current;
+        g.dialBelow = g.below.current;
+        g.dialValid = true;
+    }
+    graphics_release_frame_buffer(ctx, fb);
+}
+
+/* Find the rows to repaint over the cached dial, which was drawn with an
+   older horizon: those between the old and the new horizon lines, grown
+   to take in any marking that crosses them, so that no marking is
+   blended over itself.  Returns false if the horizon has not moved. */
+static bool dialBand(GRect bounds, int16_t* top, int16_t* bottom) {
+
+    if (g.dialAbove == g.above.current && g.dialBelow == g.below.current) {
+        return false;
+    }
+
+    int16_t centerY = grect_center_point(&bounds).y;
+    int16_t lo = INT16_MAX;
+    int16_t hi = INT16_MIN;
+    if (g.dialAbove != g.above.current) {
+        lo = centerY + minInt16(g.dialAbove, g.above.current) - 1;
+        hi = centerY + maxInt16(g.dialAbove, g.above.current);
+    }
+    if (g.dialBelow != g.below.current) {
+        lo = minInt16(lo, centerY + minInt16(g.dialBelow, g.below.current));
+        hi = maxInt16(hi, centerY + maxInt16(g.dialBelow, g.below.current) + 1);
+    }
+
+    FPoint fcenter = g2fpoint(grect_center_point(&bounds));
+    FPoint hours[24];
+    hourPoints(fcenter, hours);
+    bool grown = true;
+    while (grown) {
+        grown = false;
+        for (int h = 0; h < 24; ++h) {
+            int16_t markTop, markBottom;
+            markingRows(hours[h], h, &markTop, &markBottom);
+            if (markBottom > lo && markTop < hi && (markTop < lo || markBottom > hi)) {
+                lo = minInt16(lo, markTop);
+                hi = maxInt16(hi, markBottom);
+                grown = true;
+            }
+        }
+    }
+
+    *top = maxInt16(lo, *top);
+    *bottom = minInt16(hi, *bottom);
+    return *top < *bottom;
+}
+
+// --------------------------------------------------------------------------
+// Retained readout.
+// --------------------------------------------------------------------------
+
+/* Copy the pixels inside the readout disc to (save) or from (restore) a
+   packed buffer and return the number of bytes transferred, like
+   transferFrame.  Pixels outside the disc are never touched, so the
+   animated dial around it shows through. */
+static size_t transferReadout(GBitmap* fb, GPoint center, int16_t radius, uint8_t* buffer, bool save) {
+    GRect frame = gbitmap_get_bounds(fb);
+    size_t offset = 0;
+    for (int16_t dy = -radius; dy <= radius; ++dy) {
+        int16_t y = center.y + dy;
+        if (y < 0 || y >= frame.size.h) {
+            continue;
+        }
+        int16_t half = usqrt(radius * radius - dy * dy) >> SQRT_SHIFT;
+        int16_t x0 = maxInt16(center.x - half, 0);
+        int16_t x1 = minInt16(center.x + half, frame.size.w - 1);
+#if defined(PBL_BW)
+        if (x0 > x1) {
+            continue;
+        }
+        uint8_t* data = gbitmap_get_data(fb) + y * gbitmap_get_bytes_per_row(fb) + x0 / 8;
+        size_t length = x1 / 8 - x0 / 8 + 1;
+        if (buffer && save) {
+            memcpy(buffer + offset, data, length);
+        } else if (buffer) {
+            /* Keep the pixels that share the end bytes with the disc. */
+            uint8_t head = data[0];
+            uint8_t tail = data[length - 1];
+            uint8_t first = 0xff << (x0 & 7);
+            uint8_t last = 0xff >> (7 - (x1 & 7));
+            memcpy(data, buffer + offset, length);
+            data[0] = (head & ~first) | (data[0] & first);
+            data[length - 1] = (tail & ~last) | (data[length - 1] & last);
+        }
+#else
+        GBitmapDataRowInfo row = gbitmap_get_data_row_info(fb, y);
+        x0 = maxInt16(x0, row.min_x);
+        x1 = minInt16(x1, row.max_x);
+        if (x0 > x1) {
+            continue;
+        }
+        size_t length = x1 - x0 + 1;
+        if (buffer) {
+            uint8_t* data = row.data + x0;
+            memcpy(save ? buffer + offset : data, save ? data : buffer + offset, length);
+        }
+#endif
+        offset += length;
+    }
+    return offset;
+}
+
+static void invalidateReadout() {
+    g.readoutValid = false;
+}
+
+static bool restoreReadout(GContext* ctx, GRect bounds) {
+    if (!g.readoutValid) {
+        return false;
+    }
+    GBitmap* fb = graphics_capture_frame_buffer(ctx);
+    if (!fb) {
+        return false;
+    }
+    transferReadout(fb, grect_center_point(&bounds), FIXED_TO_INT(g.layout.readoutDiscRadius), g.readoutCache, false);
+    graphics_release_frame_buffer(ctx, fb);
+    return true;
+}
+
+/* Save the readout with its text, as drawn on the first animation frame.
+   Like the dial cache, it is only allocated if the heap can spare it. */
+static void captureReadout(GContext* ctx, GRect bounds) {
+    GBitmap* fb = graphics_capture_frame_buffer(ctx);
+    if (!fb) {
+        return;
+    }
+    GPoint center = grect_center_point(&bounds);
+    int16_t radius = FIXED_TO_INT(g.layout.readoutDiscRadius);
+    if (!g.readoutCache) {
+        size_t size = transferReadout(fb, center, radius, NULL, true);
+        if (heap_bytes_free() >= size + DIAL_HEAP_MARGIN) {
+            g.readoutCache = malloc(size);
+        }
+    }
+    if (g.readoutCache) {
+        transferReadout(fb, center, radius, g.readoutCache, true);
+        g.readoutValid = true;
+    }
+    graphics_release_frame_buffer(ctx, fb);
+}
+
+static inline FPoint batteryPoint(int k, fixed_t side) {
+    FPoint pt;
+    pt.x = g.layout.battery_x[k] * side;
+    pt.y = g.layout.readoutDiscRadius - g.layout.strokeWidth / 2 - INT_TO_FIXED(k);
+    return pt;
+}
 
-    tuple = dict_find(received, MESSAGE_KEY_SUNSET);
-    if (tuple) {
-        g.location.sunset = tuple->value->int32;
-        persist_write_int(PersistKeySunset,    g.location.sunset);
+static void plotDish(FContext* fctx, int32_t height) {
+    if (height < 0) {
+        fctx_set_scale(fctx, FPoint(1,1), FPoint(1,-1));
+        drawBatteryDish(fctx, -height);
+    } else {
+        fctx_set_scale(fctx, FPointOne, FPointOne);
+        drawBatteryDish(fctx, height);
     }
+}
 
-    tuple = dict_find(received, MESSAGE_KEY_SUNSOUTH);
-    if (tuple) {
-        g.location.sunsouth = tuple->value->int32;
-        persist_write_int(PersistKeySunSouth,  g.location.sunsouth);
+/* The pixels a dish may touch, with a pixel of margin. */
+static GRect dishBounds(GPoint center, int32_t height) {
+    int16_t rows = (height < 0) ? -height : height;
+    int16_t half = FIXED_TO_INT(g.layout.battery_x[rows - 1]) + 1;
+    int16_t bottom = FIXED_TO_INT(g.layout.readoutDiscRadius - g.layout.strokeWidth / 2) + 1;
+    int16_t top = bottom - rows - 1;
+    GRect bounds = GRect(center.x - half, center.y + top, 2 * half, rows + 2);
+    if (height < 0) {
+        bounds.origin.y = center.y - bottom;
     }
+    return bounds;
+}
 
-    tuple = dict_find(received, MESSAGE_KEY_SUNSTAT);
-    if (tuple) {
-        g.location.sunstat = tuple->value->int32;
-        persist_write_int(PersistKeySunStatus, g.location.sunstat);
+static void drawBatteryDish(FContext* fctx, int height) {
+    int top = height - 1;
+    int k = top;
+    fctx_move_to(fctx, batteryPoint(k--, -1));
+    while (k >= 0) {
+        fctx_line_to(fctx, batteryPoint(k--, -1));
     }
+    while (k <= top) {
+        fctx_line_to(fctx, batteryPoint(k++, +1));
+    }
+    fctx_close_path(fctx);
+}
+
+// --------------------------------------------------------------------------
+
+// --------------------------------------------------------------------------
+
+#if !SCREENSHOT
+static void timeChanged(struct tm* gregorian, TimeUnits unitsChanged) {
+    g.gregorian = *gregorian;
+    ++g.counters.ticks;
+    if (unitsChanged & DAY_UNIT) {
+        configureClock();
+    }
+    bool stepped = applyPolicy();
+    if (unitsChanged & MINUTE_UNIT) {
+        telemetryAdd(TelemetryMinuteRedraws, 1);
+        scheduleRedraw(DirtyTime);
+        if (!stepped) {
+            stepSun();
+        }
+    }
+    if (unitsChanged & DAY_UNIT) {
+        animateClock();
+    }
+}
+
+static void bluetoothConnected(bool connected) {
+    telemetryAdd(TelemetryBluetoothEvents, 1);
+    if (connected == g.bluetooth) {
+        return;
+    }
+    g.bluetooth = connected;
+    scheduleRedraw(DirtyDishes);
+    applyPolicy();
+}
+#endif
+
+/* The battery is shown in tenths, so most changes of the percentage do
+   not change anything on screen. */
+static void batteryStateChanged(BatteryChargeState charge) {
+    telemetryAdd(TelemetryBatteryEvents, 1);
+    uint16_t battery = (charge.charge_percent + 5) / 10;
+    bool charging = charge.is_charging || charge.is_plugged;
+    if (g.policy && battery == g.battery && charging == g.charging) {
+        return;
+    }
+    g.battery = battery;
+    g.charging = charging;
+    if (g.policy) {
+        scheduleRedraw(DirtyDishes);
+        applyPolicy();
+    }
+}
+
+#if !SCREENSHOT
+/* A flick of the wrist restores the full policy for a while. */
+static void tapped(AccelAxisType axis, int32_t direction) {
+    g.wakeTime = time(NULL);
+    applyPolicy();
+}
+#endif
+
+/* The obstructed layout is computed once, the first time the system
+   announces an obstruction of that size, before the slide starts. */
+static void unobstructedWillChange(GRect final, void* context) {
+    GSize size = final.size;
+    if (!gsize_equal(&size, &kFullLayout.size)
+        && !gsize_equal(&size, &g.obstructedLayout.size)) {
+        computeLayout(&g.obstructedLayout, size);
+    }
+    g.sliding = true;
+    updateQuality();
+}
+
+static void unobstructedChange(AnimationProgress progress, void* context) {
+    applyLayout(layer_get_unobstructed_bounds(window_get_root_layer(g.window)).size);
+}
+
+static void unobstructedDidChange(void* context) {
+    g.sliding = false;
+    updateQuality();
+    logQuality();
+    applyLayout(layer_get_unobstructed_bounds(window_get_root_layer(g.window)).size);
+}
+
+// ---------------------------------------------------------------------------
+//
+// ---------------------------------------------------------------------------
+
+#if !SCREENSHOT
+/* The phone asks what fix and sun table the watch has, so that it only
+   skips sending a fix the watch already holds.  The reply is a STATE
+   byte array, little endian:
+
+     int32   timestamp       of the fix, seconds since 1970, 0 if none
+     uint16  firstDay        of the sun table
+     uint8   count           days in the sun table, 0 if none */
+static void stateSend() {
+    DictionaryIterator* iter;
+    if (APP_MSG_OK != app_message_outbox_begin(&iter)) {
+        return;
+    }
+    uint32_t timestamp = g.location.timestamp;
+    uint8_t buffer[] = {
+        timestamp, timestamp >> 8, timestamp >> 16, timestamp >> 24,
+        g.sunTable.firstDay, g.sunTable.firstDay >> 8,
+        g.sunTable.count,
+    };
+    dict_write_data(iter, MESSAGE_KEY_STATE, buffer, sizeof(buffer));
+    app_message_outbox_send();
+}
+
+static void messageReceived(DictionaryIterator* received, void* context) {
+
+    telemetryAdd(TelemetryInboxEvents, 1);
+    telemetryAdd(TelemetryInboxBytes, dict_size(received));
+
+    if (dict_find(received, MESSAGE_KEY_STATE)) {
+        stateSend();
+    }
+#if PROFILE
+    if (dict_find(received, MESSAGE_KEY_PROFILE)) {
+        profileSend();
+    }
+#endif
+#if TELEMETRY
+    if (dict_find(received, MESSAGE_KEY_TELEMETRY)) {
+        telemetrySend();
+    }
+#endif
+
+    Tuple* tuple = dict_find(received, MESSAGE_KEY_RECORD);
+    if (!tuple || TUPLE_BYTE_ARRAY != tuple->type) {
+        return;
+    }
+
+    RecordReader reader = {
+        .data = tuple->value->data,
+        .end = tuple->value->data + tuple->length,
+    };
+    uint8_t version = readUint8(&reader);
+    uint8_t contents = readUint8(&reader);
+    if (version != RECORD_VERSION) {
+        APP_LOG(APP_LOG_LEVEL_WARNING, "unknown record version %d", version);
+        return;
+    }
+
+    if (contents & RecordConfig) {
+        uint8_t bluetoothAlert = readUint8(&reader);
+        bool batteryIndicator = readUint8(&reader) != 0;
+        if (bluetoothAlert != g.bluetoothAlert || batteryIndicator != g.batteryIndicator) {
+            g.bluetoothAlert = bluetoothAlert;
+            g.batteryIndicator = batteryIndicator;
+            scheduleRedraw(DirtyDishes);
+        }
+        uint8_t palette[PaletteSize];
+        int length = readBytes(&reader, palette, readUint8(&reader), PaletteSize);
+        if (length != g.paletteLength || 0 != memcmp(palette, g.palette, length)) {
+            applyPalette(palette, length);
+            scheduleRedraw(DirtyPalette);
+        }
+    }
+
+    if (contents & RecordLocation) {
+        g.location.timestamp = readInt32(&reader);
+        g.location.timezone  = readInt32(&reader);
+        g.location.longitude = readInt32(&reader);
+        g.location.latitude  = readInt32(&reader);
+
+        SunTable table;
+        memset(&table, 0, sizeof(table));
+        int length = readBytes(&reader, &table, reader.end - reader.data, sizeof(table));
+        int count = (length - (int)offsetof(SunTable, days)) / (int)sizeof(SunEvents);
+        if (count < 0) {
+            count = 0;
+        }
+        if (table.count > count) {
+            table.count = count;
+        }
+        if (0 != memcmp(&g.sunTable, &table, sizeof(table))) {
+            g.sunTable = table;
+            persist_write_data(PersistKeySunTable, &g.sunTable, sizeof(g.sunTable));
+            telemetryAdd(TelemetryPersistWrites, 1);
+        }
 
-    tuple = dict_find(received, MESSAGE_KEY_TIMESTAMP);
-    if (tuple) {
-        g.location.timestamp = tuple->value->int32;
-        persist_write_int(PersistKeyTimestamp, g.location.timestamp);
         logLocationFix(&g.location);
         configureClock();
+        applyPolicy();
         animateClock();
     }
 
+    saveState();
 }
+#endif
 
 // --------------------------------------------------------------------------
 // Utility functions.
 // --------------------------------------------------------------------------
 
-static inline FPoint clockPoint(FPoint center, fixed_t radius, uint32_t angle) {
-    FPoint pt;
-    int32_t c = cos_lookup(angle);
-    int32_t s = sin_lookup(angle);
-    pt.x = center.x - s * radius / TRIG_MAX_RATIO;
-    pt.y = center.y + c * radius / TRIG_MAX_RATIO;
-    return pt;
+#if !SCREENSHOT
+/* Record readers return zero once the record runs out, so a short record
+   decodes as defaults instead of reading past the tuple. */
+static uint8_t readUint8(RecordReader* reader) {
+    if (reader->data >= reader->end) {
+        return 0;
+    }
+    return *reader->data++;
+}
+
+static int32_t readInt32(RecordReader* reader) {
+    uint32_t value = 0;
+    for (int k = 0; k < 4; ++k) {
+        value |= (uint32_t)readUint8(reader) << (8 * k);
+    }
+    return (int32_t)value;
+}
+
+/* Consume `length` bytes and copy as many as fit in the buffer. */
+static int readBytes(RecordReader* reader, void* buffer, int length, int capacity) {
+    int available = reader->end - reader->data;
+    if (length > available) {
+        length = available;
+    }
+    int copied = (length < capacity) ? length : capacity;
+    memcpy(buffer, reader->data, copied);
+    reader->data += length;
+    return copied;
+}
+#endif
+
+/* The points for each hour on the sun orbit of the rotated dial.  Same
+   as clock_point at hour_angle(h) + g.rotation.current, but from the unit
+   vectors in kHourUnit, so a frame only looks up the rotation once. */
+static void hourPoints(FPoint center, FPoint* points) {
+    clock_points(center, g.layout.sunOrbitRadius, kHourUnit, 24,
+                 rotation_from_angle(g.rotation.current), points);
 }
 
 static inline GColor colorFromConfig(uint8_t cc) {
@@ -851,6 +2282,8 @@ static inline GColor colorFromConfig(uint8_t cc) {
 }
 
 static void applyPalette(const uint8_t* palette, int16_t length) {
+    memcpy(g.palette, palette, length);
+    g.paletteLength = length;
     int k;
     for (k = 0; k < length; ++k) {
         g.colors[k] = colorFromConfig(palette[k]);
@@ -858,8 +2291,456 @@ static void applyPalette(const uint8_t* palette, int16_t length) {
     for (; k < PaletteSize; ++k) {
         g.colors[k] = colorFromConfig(kDefaultPalette[k]);
     }
+    invalidateDial();
+}
+
+// --------------------------------------------------------------------------
+// Persistent state.
+// --------------------------------------------------------------------------
+
+/* Read the version 1 layout, one value per key, into a record. */
+static void readLegacyState(PersistState* state) {
+
+    if (persist_exists(PersistKeyBattery)) {
+        state->batteryIndicator = persist_read_bool(PersistKeyBattery);
+    }
+
+    if (persist_exists(PersistKeyBluetooth)) {
+        state->bluetoothAlert = persist_read_int(PersistKeyBluetooth);
+    }
+
+    if (persist_exists(PersistKeyPalette)) {
+        int length = persist_read_data(PersistKeyPalette, state->palette, PaletteSize);
+        state->paletteLength = (length > 0) ? length : 0;
+    }
+
+    if (persist_exists(PersistKeyTimestamp)) {
+        state->timestamp = persist_read_int(PersistKeyTimestamp);
+        state->timezone  = persist_read_int(PersistKeyTimezone);
+        state->longitude = persist_read_int(PersistKeyLongitude);
+        state->latitude  = persist_read_int(PersistKeyLatitude);
+    }
+
+    for (uint32_t key = PersistKeyVersion; key <= PersistKeyPalette; ++key) {
+        persist_delete(key);
+    }
 }
 
+/* Load the persistent record, upgrading it from whatever version is in
+   storage.  Each upgrade step brings the record one version forward, so
+   the cases fall through. */
+static void loadState() {
+
+    PersistState state = {
+        .version = PERSIST_VERSION,
+        .bluetoothAlert = 1,
+        .batteryIndicator = true,
+        .paletteLength = 0,
+    };
+
+    int length = persist_read_data(PersistKeyState, &state, sizeof(state));
+    int version = (length > 0) ? state.version : persist_read_int(PersistKeyVersion);
+
+    switch (version) {
+        case 0:
+            /* remove persistent data from old install */
+            for (uint32_t key = 100; key < 113; ++key) {
+                persist_delete(key);
+            }
+            /* fall through */
+        case 1:
+            readLegacyState(&state);
+            state.version = PERSIST_VERSION;
+            /* fall through */
+        case PERSIST_VERSION:
+            break;
+        default:
+            /* written by a newer release; start over */
+            APP_LOG(APP_LOG_LEVEL_WARNING, "unknown persist version %d", version);
+            state = (PersistState) {
+                .version = PERSIST_VERSION,
+                .bluetoothAlert = 1,
+                .batteryIndicator = true,
+                .paletteLength = 0,
+            };
+            break;
+    }
+
+    g.bluetoothAlert = state.bluetoothAlert;
+    g.batteryIndicator = state.batteryIndicator;
+    if (state.paletteLength > 0) {
+        applyPalette(state.palette, state.paletteLength);
+    } else {
+        applyPalette(kDefaultPalette, PaletteSize);
+        g.paletteLength = 0;
+    }
+
+    g.location.timestamp = state.timestamp;
+    g.location.timezone  = state.timezone;
+    g.location.longitude = state.longitude;
+    g.location.latitude  = state.latitude;
+    if (g.location.timestamp) {
+        logLocationFix(&g.location);
+    }
+
+    /* Only what is actually in storage counts as persisted. */
+    if (version == PERSIST_VERSION) {
+        g.persisted = state;
+    } else {
+        memset(&g.persisted, 0, sizeof(g.persisted));
+        saveState();
+    }
+}
+
+/* Write the persistent record, if anything in it has changed.  Called once
+   at the end of each inbox message, so several settings changed together
+   cost one flash write. */
+static void saveState() {
+
+    PersistState state;
+    memset(&state, 0, sizeof(state));
+    state.version = PERSIST_VERSION;
+    state.bluetoothAlert = g.bluetoothAlert;
+    state.batteryIndicator = g.batteryIndicator;
+    state.paletteLength = g.paletteLength;
+    memcpy(state.palette, g.palette, g.paletteLength);
+    state.timestamp = g.location.timestamp;
+    state.timezone  = g.location.timezone;
+    state.longitude = g.location.longitude;
+    state.latitude  = g.location.latitude;
+
+    if (0 != memcmp(&state, &g.persisted, sizeof(state))) {
+        persist_write_data(PersistKeyState, &state, sizeof(state));
+        telemetryAdd(TelemetryPersistWrites, 1);
+        g.persisted = state;
+    }
+}
+
+// --------------------------------------------------------------------------
+// Screenshot.
+// --------------------------------------------------------------------------
+
+#if SCREENSHOT
+
+/* Fixed scenes, so that screenshots from every platform, and from one
+   build to the next, show exactly the same moment and can be compared
+   pixel for pixel.  SCREENSHOT picks the scene, counting from 1.  The
+   scene replaces the clock, the battery, bluetooth, the location and the
+   palette, and the services that would update them are not started.
+   The cost of each frame is logged, for comparing builds. */
+
+typedef struct {
+    int16_t year;
+    int8_t month;
+    int8_t day;
+    int8_t hour;
+    int8_t minute;
+    int16_t timezone;   // minutes east of UTC
+    int32_t longitude;  // degrees * 0x10000, east positive
+    int32_t latitude;   // degrees * 0x10000, north positive
+    uint8_t battery;    // percent
+    bool bluetooth;
+} ScreenshotScene;
+
+static const ScreenshotScene kScreenshotScenes[] = {
+    /* Summer afternoon in Seattle, the original screenshot. */
+    { 2016, 6, 21, 13, 50, -7 * 60, -122 * 0x10000 - 0x5400, 47 * 0x10000 + 0x9c00, 100, true },
+    /* Winter night, low battery, phone disconnected. */
+    { 2016, 12, 21, 3, 10, -8 * 60, -122 * 0x10000 - 0x5400, 47 * 0x10000 + 0x9c00, 15, false },
+    /* Equinox sunrise on the equator. */
+    { 2016, 3, 20, 6, 5, 0, 0, 0, 50, true },
+    /* Midnight sun in Svalbard. */
+    { 2016, 6, 21, 0, 30, 2 * 60, 15 * 0x10000 + 0x9c00, 78 * 0x10000 + 0x3b00, 80, true },
+};
+
+static struct {
+    uint32_t frameStart;
+    uint16_t frames;
+} shot;
+
+static void screenshotScene() {
+    const ScreenshotScene* scene = &kScreenshotScenes[(SCREENSHOT - 1) % ARRAY_LENGTH(kScreenshotScenes)];
+
+    struct tm date;
+    memset(&date, 0, sizeof(date));
+    date.tm_year = scene->year - 1900;
+    date.tm_mon = scene->month - 1;
+    date.tm_mday = scene->day;
+    date.tm_hour = scene->hour;
+    date.tm_min = scene->minute;
+    mktime(&date);
+    date.tm_gmtoff = scene->timezone * 60;
+    g.gregorian = date;
+    g.kilter = 0;
+
+    g.bluetooth = scene->bluetooth;
+    batteryStateChanged((BatteryChargeState) { .charge_percent = scene->battery });
+
+    g.location.timestamp = 1;
+    g.location.timezone = scene->timezone;
+    g.location.longitude = scene->longitude;
+    g.location.latitude = scene->latitude;
+    g.sunTable.count = 0;
+
+    applyPalette(kDefaultPalette, PaletteSize);
+}
+
+static void screenshotFrameBegin() {
+    shot.frameStart = clockMillis();
+}
+
+static void screenshotFrameDone() {
+    APP_LOG(APP_LOG_LEVEL_INFO, "screenshot %d frame %d: %lu ms",
+        SCREENSHOT, ++shot.frames, clockMillis() - shot.frameStart);
+}
+
+#endif
+
+// --------------------------------------------------------------------------
+// Benchmark.
+// --------------------------------------------------------------------------
+
+#if BENCHMARK
+
+/* Redraw the whole scene BENCHMARK_FRAMES times back to back, first with
+   the dial rebuilt on every frame and then with the dial served from the
+   cache, and log the per-frame cost of each layer.  This runs in the
+   emulator as well as on a watch, for every platform. */
+
+static const char* kBenchPhaseNames[BenchPhaseCount] = {
+    "dial", "sun", "readout", "text"
+};
+
+static struct {
+    bool running;
+    bool cold;
+    uint32_t frames;
+    uint32_t mark;
+    uint32_t frameStart;
+    uint32_t frameMin;
+    uint32_t frameMax;
+    uint32_t phaseTotal[BenchPhaseCount];
+} bench;
+
+static void benchNextFrame(void* context) {
+    if (bench.cold) {
+        invalidateDial();
+    }
+    markClockDirty();
+}
+
+static void benchReset(bool cold) {
+    memset(&bench, 0, sizeof(bench));
+    bench.running = true;
+    bench.cold = cold;
+    bench.frameMin = UINT32_MAX;
+}
+
+static void benchStart(void* context) {
+    benchReset(true);
+    benchNextFrame(NULL);
+}
+
+static void benchPhase(BenchPhase phase) {
+    if (!bench.running) {
+        return;
+    }
+    uint32_t now = clockMillis();
+    if (phase == BenchPhaseDial) {
+        bench.frameStart = now;
+    } else {
+        bench.phaseTotal[phase - 1] += now - bench.mark;
+    }
+    bench.mark = now;
+}
+
+static void benchFrameDone() {
+    if (!bench.running) {
+        return;
+    }
+    uint32_t now = clockMillis();
+    uint32_t frame = now - bench.frameStart;
+    bench.phaseTotal[BenchPhaseText] += now - bench.mark;
+    if (frame < bench.frameMin) bench.frameMin = frame;
+    if (frame > bench.frameMax) bench.frameMax = frame;
+
+    if (++bench.frames < BENCHMARK_FRAMES) {
+        app_timer_register(0, benchNextFrame, NULL);
+        return;
+    }
+
+    uint32_t total = 0;
+    for (int k = 0; k < BenchPhaseCount; ++k) {
+        uint32_t phase = bench.phaseTotal[k] * 100 / bench.frames;
+        APP_LOG(APP_LOG_LEVEL_INFO, "bench %s %s: %lu.%02lu ms/frame",
+            bench.cold ? "cold" : "warm", kBenchPhaseNames[k], phase / 100, phase % 100);
+        total += bench.phaseTotal[k];
+    }
+    total = total * 100 / bench.frames;
+    APP_LOG(APP_LOG_LEVEL_INFO, "bench %s frame: %lu.%02lu ms (min %lu, max %lu) over %lu frames",
+        bench.cold ? "cold" : "warm", total / 100, total % 100,
+        bench.frameMin, bench.frameMax, bench.frames);
+
+    if (bench.cold) {
+        benchReset(false);
+        app_timer_register(0, benchNextFrame, NULL);
+    } else {
+        bench.running = false;
+    }
+}
+
+#endif
+
+// --------------------------------------------------------------------------
+// Profile.
+// --------------------------------------------------------------------------
+
+#if PROFILE
+
+/* Time each drawing phase of every frame as it is rendered in normal use,
+   and keep the last PROFILE_FRAMES frames.  The phone asks for them with
+   a PROFILE message, and gets back a PROFILE byte array:
+
+     uint8   phaseCount
+     uint8   frameCount
+     frameCount x phaseCount x uint8 milliseconds, oldest frame first
+
+   A phase that was not drawn in a frame, because it came from a cache,
+   reads PROFILE_SKIPPED. */
+
+#define PROFILE_SKIPPED 0xff
+
+static struct {
+    uint8_t samples[PROFILE_FRAMES][ProfilePhaseCount];
+    uint8_t head;
+    uint8_t count;
+    uint32_t mark;
+} profile;
+
+static void profileFrameBegin() {
+    profile.head = (profile.head + 1) % PROFILE_FRAMES;
+    if (profile.count < PROFILE_FRAMES) {
+        ++profile.count;
+    }
+    memset(profile.samples[profile.head], PROFILE_SKIPPED, ProfilePhaseCount);
+}
+
+static void profileStart() {
+    profile.mark = clockMillis();
+}
+
+static void profileEnd(ProfilePhase phase) {
+    uint32_t now = clockMillis();
+    uint32_t elapsed = now - profile.mark;
+    uint8_t* sample = &profile.samples[profile.head][phase];
+    if (*sample != PROFILE_SKIPPED) {
+        elapsed += *sample;
+    }
+    *sample = (elapsed < PROFILE_SKIPPED) ? elapsed : PROFILE_SKIPPED - 1;
+    profile.mark = now;
+}
+
+static void profileSend() {
+    DictionaryIterator* iter;
+    if (APP_MSG_OK != app_message_outbox_begin(&iter)) {
+        return;
+    }
+    uint8_t buffer[2 + PROFILE_FRAMES * ProfilePhaseCount];
+    uint8_t* p = buffer;
+    *p++ = ProfilePhaseCount;
+    *p++ = profile.count;
+    for (int k = profile.count - 1; k >= 0; --k) {
+        int frame = (profile.head + PROFILE_FRAMES - k) % PROFILE_FRAMES;
+        memcpy(p, profile.samples[frame], ProfilePhaseCount);
+        p += ProfilePhaseCount;
+    }
+    dict_write_data(iter, MESSAGE_KEY_PROFILE, buffer, p - buffer);
+    app_message_outbox_send();
+}
+
+#endif
+
+// --------------------------------------------------------------------------
+// Telemetry.
+// --------------------------------------------------------------------------
+
+#if TELEMETRY
+
+/* Counts of what woke the face and what it did, per hour, for the last
+   TELEMETRY_HOURS hours.  The ring is written to storage when an hour
+   ends and on exit, not on every event, and is sent to the phone on
+   request.  Counts stop at UINT16_MAX. */
+
+#define TELEMETRY_VERSION 2
+
+typedef struct __attribute__((packed)) {
+    uint16_t hour;      // hours since 1970, modulo 65536
+    uint16_t counts[TelemetryCount];
+} TelemetryBucket;
+
+static struct __attribute__((packed)) {
+    uint8_t version;
+    uint8_t head;       // the current bucket
+    uint8_t count;      // buckets in use, ending at head
+    TelemetryBucket buckets[TELEMETRY_HOURS];
+} telemetry;
+
+static void telemetryLoad() {
+    int length = persist_read_data(PersistKeyTelemetry, &telemetry, sizeof(telemetry));
+    if (length != (int)sizeof(telemetry) || telemetry.version != TELEMETRY_VERSION
+        || telemetry.head >= TELEMETRY_HOURS || telemetry.count > TELEMETRY_HOURS) {
+        memset(&telemetry, 0, sizeof(telemetry));
+        telemetry.version = TELEMETRY_VERSION;
+    }
+}
+
+static void telemetrySave() {
+    TelemetryBucket* bucket = &telemetry.buckets[telemetry.head];
+    if (bucket->counts[TelemetryPersistWrites] < UINT16_MAX) {
+        ++bucket->counts[TelemetryPersistWrites];
+    }
+    persist_write_data(PersistKeyTelemetry, &telemetry, sizeof(telemetry));
+}
+
+static void telemetryAdd(TelemetryCounter counter, uint32_t amount) {
+    uint16_t hour = time(NULL) / 3600;
+    TelemetryBucket* bucket = &telemetry.buckets[telemetry.head];
+    if (telemetry.count == 0 || bucket->hour != hour) {
+        telemetry.head = (telemetry.head + 1) % TELEMETRY_HOURS;
+        if (telemetry.count < TELEMETRY_HOURS) {
+            ++telemetry.count;
+        }
+        bucket = &telemetry.buckets[telemetry.head];
+        memset(bucket, 0, sizeof(*bucket));
+        bucket->hour = hour;
+        telemetrySave();
+    }
+    uint32_t sum = bucket->counts[counter] + amount;
+    bucket->counts[counter] = (sum < UINT16_MAX) ? sum : UINT16_MAX;
+}
+
+/* Reply with the used buckets, oldest first, as the counter count, the
+   bucket count, and then each bucket as little endian uint16 values. */
+static void telemetrySend() {
+    DictionaryIterator* iter;
+    if (APP_MSG_OK != app_message_outbox_begin(&iter)) {
+        return;
+    }
+    uint8_t buffer[2 + sizeof(telemetry.buckets)];
+    uint8_t* p = buffer + 2;
+    for (int k = telemetry.count - 1; k >= 0; --k) {
+        const TelemetryBucket* bucket = &telemetry.buckets[(telemetry.head + TELEMETRY_HOURS - k) % TELEMETRY_HOURS];
+        memcpy(p, bucket, sizeof(*bucket));
+        p += sizeof(*bucket);
+    }
+    buffer[0] = TelemetryCount;
+    buffer[1] = telemetry.count;
+    dict_write_data(iter, MESSAGE_KEY_TELEMETRY, buffer, p - buffer);
+    app_message_outbox_send();
+}
+
+#endif
+
 void logLocationFix(LocationFix* loc) {
 #if 0
     int8_t tzhour = loc->timezone / 60;
@@ -0,0 +1,265 @@
+
+#include "spans.h"
+#include "geometry.h"
+
+#define HALF_PIXEL (FIXED_POINT_SCALE / 2)
+
+static bool antialias = true;
+static int16_t coverageBias = 0;
+
+typedef struct {
+    uint8_t* data;
+    int16_t minX;
+    int16_t maxX;
+} SpanRow;
+
+static inline bool spanRow(GBitmap* fb, int16_t y, SpanRow* row) {
+    GRect bounds = gbitmap_get_bounds(fb);
+    if (y < 0 || y >= bounds.size.h) {
+        return false;
+    }
+#if defined(PBL_BW)
+    row->data = gbitmap_get_data(fb) + y * gbitmap_get_bytes_per_row(fb);
+    row->minX = 0;
+    row->maxX = bounds.size.w - 1;
+#else
+    GBitmapDataRowInfo info = gbitmap_get_data_row_info(fb, y);
+    row->data = info.data;
+    row->minX = info.min_x;
+    row->maxX = info.max_x;
+#endif
+    return true;
+}
+
+#if defined(PBL_BW)
+/* The byte pattern of a color on a 1-bit row: gray is a checkerboard. */
+static inline uint8_t bwPattern(GColor color, int16_t y) {
+    if (gcolor_equal(color, GColorWhite)) return 0xff;
+    if (gcolor_equal(color, GColorBlack)) return 0x00;
+    return (y & 1) ? 0x55 : 0xaa;
+}
+#else
+static inline uint8_t blendChannel(uint8_t dst, uint8_t src, uint8_t alpha) {
+    return (src * alpha + dst * (3 - alpha) + 1) / 3;
+}
+#endif
+
+/* Fill the pixels x0 to x1 of a row. */
+static void fillRun(const SpanRow* row, int16_t y, int16_t x0, int16_t x1, GColor color) {
+    if (x0 < row->minX) x0 = row->minX;
+    if (x1 > row->maxX) x1 = row->maxX;
+    if (x0 > x1) {
+        return;
+    }
+#if defined(PBL_BW)
+    uint8_t pattern = bwPattern(color, y);
+    uint8_t* first = row->data + x0 / 8;
+    uint8_t* last = row->data + x1 / 8;
+    uint8_t head = 0xff << (x0 & 7);
+    uint8_t tail = 0xff >> (7 - (x1 & 7));
+    if (first == last) {
+        uint8_t mask = head & tail;
+        *first = (*first & ~mask) | (pattern & mask);
+        return;
+    }
+    *first = (*first & ~head) | (pattern & head);
+    memset(first + 1, pattern, last - first - 1);
+    *last = (*last & ~tail) | (pattern & tail);
+#else
+    memset(row->data + x0, color.argb, x1 - x0 + 1);
+#endif
+}
+
+/* Blend one pixel with a coverage of 0 to FIXED_POINT_SCALE. */
+static void blendPixel(const SpanRow* row, int16_t y, int16_t x, GColor color, int32_t coverage) {
+    if (x < row->minX || x > row->maxX) {
+        return;
+    }
+    uint8_t alpha = (coverage * 3 + HALF_PIXEL) / FIXED_POINT_SCALE;
+    if (alpha == 0) {
+        return;
+    }
+#if defined(PBL_BW)
+    if (alpha >= 2) {
+        uint8_t mask = 1 << (x & 7);
+        uint8_t* byte = row->data + x / 8;
+        *byte = (*byte & ~mask) | (bwPattern(color, y) & mask);
+    }
+#else
+    GColor8 dst = (GColor8) { .argb = row->data[x] };
+    dst.r = blendChannel(dst.r, color.r, alpha);
+    dst.g = blendChannel(dst.g, color.g, alpha);
+    dst.b = blendChannel(dst.b, color.b, alpha);
+    row->data[x] = dst.argb;
+#endif
+}
+
+void span_enable_aa(bool enable) {
+    antialias = enable;
+}
+
+void span_set_coverage_bias(int16_t bias) {
+    coverageBias = bias;
+}
+
+void span_fill_rect(GBitmap* fb, GRect rect, GColor color) {
+    SpanRow row;
+    for (int16_t y = rect.origin.y; y < rect.origin.y + rect.size.h; ++y) {
+        if (spanRow(fb, y, &row)) {
+            fillRun(&row, y, rect.origin.x, rect.origin.x + rect.size.w - 1, color);
+        }
+    }
+}
+
+static inline int32_t clampCoverage(int32_t c) {
+    return (c < 0) ? 0 : (c > FIXED_POINT_SCALE) ? FIXED_POINT_SCALE : c;
+}
+
+/* Fill the pixels whose centers are inside the ring, as one or two runs
+   per row. */
+static void fillRingAliased(GBitmap* fb, FPoint center, fixed_t outer, fixed_t inner, GColor color) {
+    int16_t top = FIXED_TO_INT(center.y - outer);
+    int16_t bottom = FIXED_TO_INT(center.y + outer);
+    SpanRow row;
+
+    for (int16_t y = top; y <= bottom; ++y) {
+        if (!spanRow(fb, y, &row)) {
+            continue;
+        }
+        int32_t dy = INT_TO_FIXED(y) + HALF_PIXEL - center.y;
+        int32_t reach = circle_chord(outer, dy);
+        if (reach < 0) {
+            continue;
+        }
+        int32_t hole = (inner > 0) ? circle_chord(inner, dy) : -1;
+        int16_t x0 = (center.x - reach - HALF_PIXEL + FIXED_POINT_SCALE - 1) >> FIXED_POINT_SHIFT;
+        int16_t x1 = (center.x + reach - HALF_PIXEL) >> FIXED_POINT_SHIFT;
+        if (hole < 0) {
+            fillRun(&row, y, x0, x1, color);
+        } else {
+            fillRun(&row, y, x0, (center.x - hole - HALF_PIXEL - 1) >> FIXED_POINT_SHIFT, color);
+            fillRun(&row, y, (center.x + hole + HALF_PIXEL) >> FIXED_POINT_SHIFT, x1, color);
+        }
+    }
+}
+
+void span_fill_ring(GBitmap* fb, FPoint center, fixed_t outer, fixed_t inner, GColor color) {
+
+    if (!antialias) {
+        fillRingAliased(fb, center, outer, inner, color);
+        return;
+    }
+
+    /* A pixel is covered by the part of a circle of radius r within half a
+       pixel of its center, so it is solid inside r - 1/2, empty beyond
+       r + 1/2, and blended in between.  The chords at those radii split
+       each row into runs. */
+    int16_t top = FIXED_TO_INT(center.y - outer - HALF_PIXEL);
+    int16_t bottom = FIXED_TO_INT(center.y + outer + HALF_PIXEL);
+    SpanRow row;
+
+    for (int16_t y = top; y <= bottom; ++y) {
+        if (!spanRow(fb, y, &row)) {
+            continue;
+        }
+        int32_t dy = INT_TO_FIXED(y) + HALF_PIXEL - center.y;
+        int32_t reach = circle_chord(outer + HALF_PIXEL, dy);
+        if (reach < 0) {
+            continue;
+        }
+        int32_t solid = circle_chord(outer - HALF_PIXEL, dy);
+        int32_t touch = (inner > 0) ? circle_chord(inner + HALF_PIXEL, dy) : -1;
+        int32_t empty = (inner > 0) ? circle_chord(inner - HALF_PIXEL, dy) : -1;
+
+        int16_t x0 = FIXED_TO_INT(center.x - reach) - 1;
+        int16_t x1 = FIXED_TO_INT(center.x + reach) + 1;
+        int16_t run = -1;
+        for (int16_t x = x0; x <= x1 + 1; ++x) {
+            int32_t dx = INT_TO_FIXED(x) + HALF_PIXEL - center.x;
+            int32_t adx = (dx < 0) ? -dx : dx;
+            bool full = x <= x1 && adx <= solid && adx >= touch;
+            if (full) {
+                if (run < 0) run = x;
+                continue;
+            }
+            if (run >= 0) {
+                fillRun(&row, y, run, x - 1, color);
+                run = -1;
+            }
+            if (x > x1 || adx >= reach || adx < empty) {
+                continue;
+            }
+            int32_t d = usqrt(dx * dx + dy * dy) >> SQRT_SHIFT;
+            int32_t coverage = clampCoverage(outer + HALF_PIXEL - d);
+            if (inner > 0) {
+                coverage -= clampCoverage(inner + HALF_PIXEL - d);
+            }
+            blendPixel(&row, y, x, color, clampCoverage(coverage + coverageBias));
+        }
+    }
+}
+
+SpanMask* span_mask_capture(GBitmap* fb, GRect rect) {
+    SpanMask* mask = malloc(sizeof(SpanMask) + rect.size.w * rect.size.h);
+    if (!mask) {
+        return NULL;
+    }
+    mask->width = rect.size.w;
+    mask->height = rect.size.h;
+    uint8_t* coverage = mask->data;
+    SpanRow row;
+    for (int16_t y = rect.origin.y; y < rect.origin.y + rect.size.h; ++y) {
+        bool valid = spanRow(fb, y, &row);
+        for (int16_t x = rect.origin.x; x < rect.origin.x + rect.size.w; ++x) {
+            uint8_t c = 0;
+            if (valid && x >= row.minX && x <= row.maxX) {
+#if defined(PBL_BW)
+                c = ((row.data[x / 8] >> (x & 7)) & 1) ? 3 : 0;
+#else
+                c = (row.data[x] >> 2) & 3;     // the green channel
+#endif
+            }
+            *coverage++ = c;
+        }
+    }
+    return mask;
+}
+
+void span_draw_mask(GBitmap* fb, const SpanMask* mask, FPoint center, int32_t angle, GColor color) {
+
+    /* Walk the screen pixels that the rotated mask can reach, and map
+       each one back into the mask, in 1/TRIG_MAX_RATIO pixel units, by
+       the inverse rotation.  Along a row, that is one step of (cos, -sin)
+       per pixel. */
+    int32_t c = cos_lookup(angle);
+    int32_t s = sin_lookup(angle);
+    int32_t reach = (usqrt(mask->width * mask->width + mask->height * mask->height) >> (SQRT_SHIFT + 1)) + 1;
+    int16_t x0 = FIXED_TO_INT(center.x) - reach;
+    int16_t x1 = FIXED_TO_INT(center.x) + reach;
+    int16_t y0 = FIXED_TO_INT(center.y) - reach;
+    int16_t y1 = FIXED_TO_INT(center.y) + reach;
+    int32_t halfWidth = mask->width * TRIG_MAX_RATIO / 2;
+    int32_t halfHeight = mask->height * TRIG_MAX_RATIO / 2;
+    int32_t limitX = mask->width * TRIG_MAX_RATIO;
+    int32_t limitY = mask->height * TRIG_MAX_RATIO;
+    SpanRow row;
+
+    for (int16_t y = y0; y <= y1; ++y) {
+        if (!spanRow(fb, y, &row)) {
+            continue;
+        }
+        int32_t dx = INT_TO_FIXED(x0) + HALF_PIXEL - center.x;
+        int32_t dy = INT_TO_FIXED(y) + HALF_PIXEL - center.y;
+        int32_t u = (dx * c + dy * s) / FIXED_POINT_SCALE + halfWidth;
+        int32_t v = (dy * c - dx * s) / FIXED_POINT_SCALE + halfHeight;
+        for (int16_t x = x0; x <= x1; ++x, u += c, v -= s) {
+            if (u < 0 || v < 0 || u >= limitX || v >= limitY) {
+                continue;
+            }
+            uint8_t coverage = mask->data[(v / TRIG_MAX_RATIO) * mask->width + u / TRIG_MAX_RATIO];
+            if (coverage) {
+                blendPixel(&row, y, x, color, coverage * FIXED_POINT_SCALE / 3);
+            }
+        }
+    }
+}
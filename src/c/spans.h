@@ -0,0 +1,45 @@
+#pragma once
+#include <pebble.h>
+#include <pebble-fctx/fctx.h>
+
+/* Span fills straight into a captured framebuffer.  Each row of a shape
+   is written once, as runs of solid pixels filled a word at a time, with
+   only the pixels on its edges blended by their coverage.  On 1-bit
+   displays the edges are thresholded and gray is dithered, as the
+   system does. */
+
+/* Turn the antialiasing of ring edges on or off, like fctx_enable_aa.
+   Without it, a pixel is filled if its center is inside the ring. */
+void span_enable_aa(bool enable);
+
+/* Shift the coverage of antialiased edge pixels by bias sixteenths of a
+   pixel, like fctx_set_color_bias.  A negative bias pulls a fill in
+   under a ring stroked over its edge, so that none of it shows through
+   the ring's own edges.  Solid runs are not affected.  Reset it to 0
+   after use. */
+void span_set_coverage_bias(int16_t bias);
+
+/* Fill a rectangle, clipped to the visible part of the framebuffer. */
+void span_fill_rect(GBitmap* fb, GRect rect, GColor color);
+
+/* Fill the ring between two circles, antialiased on both edges.  With an
+   inner radius of zero it is a disc. */
+void span_fill_ring(GBitmap* fb, FPoint center, fixed_t outer, fixed_t inner, GColor color);
+
+/* A coverage mask, 0 to 3 per pixel, one byte each, that can be drawn
+   back in any color and rotation. */
+typedef struct {
+    uint8_t width;
+    uint8_t height;
+    uint8_t data[];
+} SpanMask;
+
+/* Capture the coverage of a white on black drawing in a rectangle of the
+   framebuffer.  Returns NULL if there is no memory for it.  Free the
+   mask with free(). */
+SpanMask* span_mask_capture(GBitmap* fb, GRect rect);
+
+/* Draw a mask rotated clockwise by angle about its center, which lands
+   on center, like a path drawn with fctx_set_rotation.  Each pixel takes
+   the coverage of the nearest mask pixel. */
+void span_draw_mask(GBitmap* fb, const SpanMask* mask, FPoint center, int32_t angle, GColor color);
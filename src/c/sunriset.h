@@ -0,0 +1,19 @@
+#pragma once
+#include <pebble.h>
+
+/* Sun rise, set and south times for one day, in minutes from midnight UT.
+   Rise and set may fall outside 0..1440 when the event happens on the
+   previous or next UT day.  The layout is packed, because it is also the
+   layout of the sun table entries sent by the phone. */
+typedef struct __attribute__((packed)) {
+    int16_t rise;
+    int16_t set;
+    int16_t south;
+    int8_t status;  // -1 sun never rises, +1 sun never sets, 0 otherwise
+} SunEvents;
+
+/* Compute the sun events for a calendar date at a location.  Longitude
+   (east positive) and latitude (north positive) are in degrees scaled by
+   0x10000, as sent by the phone.  This is a fixed point port of
+   __sunriset__ in src/pkjs/sunriset.js. */
+void sun_rise_set(int year, int month, int day, int32_t longitude, int32_t latitude, SunEvents* events);
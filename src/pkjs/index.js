@@ -26,58 +26,387 @@ var previewComponent = new Preview(previewTemplate, previewStyle);
 var clay = new Clay(clayConfig, clayCustomFunc, { autoHandleEvents: false });
 clay.registerComponent(previewComponent);
 
-function locationMessage(pos) {
-    'use strict';
-    var coordinates = pos.coords,
-        now = new Date(),
-        sun = sunriset.sun_rise_set(now, coordinates.longitude, coordinates.latitude),
-        message = {
-            'LATITUDE': coordinates.latitude * 0x10000,
-            'LONGITUDE': coordinates.longitude * 0x10000,
-            'TIMEZONE': pos.timezone,
-            'TIMESTAMP': pos.timestamp / 1000,
-            'SUNRISE': sun.rise * 60,
-            'SUNSET': sun.set * 60,
-            'SUNSOUTH': sun.south * 60,
-            'SUNSTAT': sun.status
-        };
+/* Number of days of sun events sent to the watch with each fix. */
+var SUN_TABLE_DAYS = 30;
+
+/* Layout of the RECORD byte array, see RecordContents in main.c. */
+var RECORD_VERSION = 1;
+var RECORD_CONFIG = 1;
+var RECORD_LOCATION = 2;
+
+/* Location is first asked for coarsely, from whatever the phone already
+   knows, and only asked again with GPS if that fix is too vague.  A
+   degree of longitude moves the sun events by 4 minutes, so 5 km keeps
+   them within about a minute anywhere but near the poles. */
+var COARSE_LOCATION_OPTIONS = {
+    'enableHighAccuracy': false,
+    'timeout': 15 * 1000,           // 15 seconds
+    'maximumAge': 60 * 60 * 1000    // 1 hour
+};
+var FINE_LOCATION_OPTIONS = {
+    'enableHighAccuracy': true,
+    'timeout': 60 * 1000,           // 1 minute
+    'maximumAge': 5 * 60 * 1000     // 5 minutes
+};
+var COARSE_ACCURACY_LIMIT = 5000;   // meters
+
+/* A fix is only sent to the watch if it moves one of today's sun events
+   by at least this many minutes, changes the timezone, or the table the
+   watch has is getting old. */
+var SUN_EVENT_THRESHOLD = 1;
+var SUN_TABLE_REFRESH_DAYS = 7;
+
+/* On launch the watch is asked which fix and sun table it has, and a fix
+   is only ever skipped if the watch holds the one last sent.  Fixes wait
+   for the answer up to STATE_TIMEOUT, and without one they are sent. */
+var STATE_TIMEOUT = 10 * 1000;      // 10 seconds
+
+/* Failed sends are retried after OUTBOX_RETRY_DELAY, doubling with each
+   failure, up to OUTBOX_RETRY_LIMIT times. */
+var OUTBOX_RETRY_DELAY = 1000;      // 1 second
+var OUTBOX_RETRY_LIMIT = 5;
+
+/* Set to match the PROFILE flag in main.c, to poll the watch for render
+   timings and log them. */
+var PROFILE = false;
+var PROFILE_INTERVAL = 60 * 1000;
+var PROFILE_PHASES = ['background', 'pips', 'labels', 'sun', 'readout', 'dishes', 'stroke', 'text'];
+var PROFILE_SKIPPED = 0xff;
+
+/* Set to match the TELEMETRY flag in main.c, to fetch the hourly wake
+   counters from the watch on launch and log them as CSV. */
+var TELEMETRY = false;
+var TELEMETRY_COUNTERS = ['minute_redraws', 'animation_frames', 'inbox_events', 'inbox_bytes',
+                          'persist_writes', 'battery_events', 'bluetooth_events', 'draw_ms'];
+
+function pushInt16(bytes, value) {
+    'use strict';
+    bytes.push(value & 0xff, (value >> 8) & 0xff);
+}
+
+function pushInt32(bytes, value) {
+    'use strict';
+    value = Math.round(value) | 0;
+    pushInt16(bytes, value);
+    pushInt16(bytes, value >> 16);
+}
+
+/* Pack the sun events for the coming days, starting with the local date
+   of `now`, as the byte array the watch keeps in its SunTable.  All
+   times are in minutes UT. */
+function sunTable(now, longitude, latitude) {
+    'use strict';
+    var year = now.getFullYear(),
+        month = now.getMonth(),
+        date = now.getDate(),
+        firstDay = Math.floor(Date.UTC(year, month, date) / 86400000),
+        bytes = [],
+        sun,
+        k;
+    pushInt16(bytes, firstDay);
+    bytes.push(SUN_TABLE_DAYS);
+    for (k = 0; k < SUN_TABLE_DAYS; ++k) {
+        /* sun_rise_set takes the UTC calendar date, so use noon UTC of
+           the local date. */
+        sun = sunriset.sun_rise_set(new Date(Date.UTC(year, month, date + k, 12)), longitude, latitude);
+        pushInt16(bytes, Math.round(sun.rise * 60));
+        pushInt16(bytes, Math.round(sun.set * 60));
+        pushInt16(bytes, Math.round(sun.south * 60));
+        bytes.push(sun.status & 0xff);
+    }
+    return bytes;
+}
+
+function readInt32(bytes, offset) {
+    'use strict';
+    return (bytes[offset] | (bytes[offset + 1] << 8) | (bytes[offset + 2] << 16) | (bytes[offset + 3] << 24)) | 0;
+}
+
+/* Pack the configuration and/or the location fix into the single binary
+   record the watch decodes.  Either part may be null. */
+function recordMessage(config, pos) {
+    'use strict';
+    var contents = (config ? RECORD_CONFIG : 0) | (pos ? RECORD_LOCATION : 0),
+        bytes = [RECORD_VERSION, contents],
+        coordinates;
+    if (config) {
+        bytes.push(config.bluetooth & 0xff, config.battery ? 1 : 0, config.palette.length);
+        Array.prototype.push.apply(bytes, config.palette);
+    }
+    if (pos) {
+        coordinates = pos.coords;
+        pushInt32(bytes, pos.timestamp / 1000);
+        pushInt32(bytes, pos.timezone);
+        pushInt32(bytes, coordinates.longitude * 0x10000);
+        pushInt32(bytes, coordinates.latitude * 0x10000);
+        Array.prototype.push.apply(bytes, sunTable(new Date(), coordinates.longitude, coordinates.latitude));
+    }
     //console.log('location: ' + JSON.stringify(pos, null, 2));
-    //console.log('sun: ' + JSON.stringify(sun, null, 2));
-    //console.log('message: ' + JSON.stringify(message, null, 2));
-    return message;
+    return { 'RECORD': bytes };
+}
+
+// --------------------------------------------------------------------------
+// Outbox
+// --------------------------------------------------------------------------
+
+/* Every message to the watch goes through one outbox, one message at a
+   time, the next one only after the last is acked, so that sends never
+   collide.  Pending parts are kept by name, and a newer part replaces an
+   older one that has not gone yet.  The config and location parts go
+   together in one RECORD; state, profile and telemetry requests go on
+   their own, since the watch inbox only has room for one value. */
+var outbox = {
+    pending: {},
+    inFlight: null,
+    retries: 0,
+    timer: null
+};
+
+function outboxPost(part, value, onAck) {
+    'use strict';
+    outbox.pending[part] = { value: value, onAck: onAck, posted: Date.now() };
+    outboxFlush();
+}
+
+/* Take the parts that go in the next message. */
+function outboxTake() {
+    'use strict';
+    var pending = outbox.pending,
+        parts = {},
+        message;
+    if (pending.state) {
+        parts.state = pending.state;
+        message = { 'STATE': 1 };
+    } else if (pending.config || pending.location) {
+        parts.config = pending.config;
+        parts.location = pending.location;
+        message = recordMessage(parts.config && parts.config.value, parts.location && parts.location.value);
+    } else if (pending.profile) {
+        parts.profile = pending.profile;
+        message = { 'PROFILE': 1 };
+    } else if (pending.telemetry) {
+        parts.telemetry = pending.telemetry;
+        message = { 'TELEMETRY': 1 };
+    } else {
+        return null;
+    }
+    _.each(_.keys(parts), function (part) {
+        delete pending[part];
+    });
+    return { parts: parts, message: message };
+}
+
+function outboxFlush() {
+    'use strict';
+    if (outbox.inFlight || outbox.timer) {
+        return;
+    }
+    var flight = outboxTake();
+    if (!flight) {
+        return;
+    }
+    outbox.inFlight = flight;
+    flight.sent = Date.now();
+    Pebble.sendAppMessage(flight.message, outboxAck, outboxNack);
+}
+
+function outboxAck() {
+    'use strict';
+    var flight = outbox.inFlight,
+        posted = _.min(_.pluck(_.compact(_.values(flight.parts)), 'posted'));
+    console.log('outbox: ' + _.keys(_.pick(flight.parts, _.identity)).join('+') + ' acked in ' +
+                (Date.now() - flight.sent) + ' ms, ' + (Date.now() - posted) + ' ms after posting, ' +
+                outbox.retries + ' retries');
+    _.each(_.compact(_.values(flight.parts)), function (entry) {
+        if (entry.onAck) {
+            entry.onAck();
+        }
+    });
+    outbox.inFlight = null;
+    outbox.retries = 0;
+    outboxFlush();
+}
+
+function outboxNack(result) {
+    'use strict';
+    var flight = outbox.inFlight,
+        delay;
+    outbox.inFlight = null;
+    if (outbox.retries >= OUTBOX_RETRY_LIMIT) {
+        console.log('outbox: giving up after ' + outbox.retries + ' retries');
+        outbox.retries = 0;
+        outboxFlush();
+        return;
+    }
+    /* Put back whatever has not been replaced since. */
+    _.each(flight.parts, function (entry, part) {
+        if (entry && !outbox.pending[part]) {
+            outbox.pending[part] = entry;
+        }
+    });
+    delay = OUTBOX_RETRY_DELAY * Math.pow(2, outbox.retries);
+    outbox.retries += 1;
+    console.log('outbox: send failed, retry ' + outbox.retries + ' in ' + delay + ' ms');
+    outbox.timer = setTimeout(function () {
+        outbox.timer = null;
+        outboxFlush();
+    }, delay);
+}
+
+// --------------------------------------------------------------------------
+// Location
+// --------------------------------------------------------------------------
+
+/* What the watch has, from its STATE reply: the timestamp of its fix, in
+   seconds, and the days its sun table covers.  Fixes wait in `deferred`
+   while the question is pending. */
+var watchState = {
+    pending: false,
+    known: null,
+    deferred: null,
+    timer: null
+};
+
+function requestState() {
+    'use strict';
+    watchState.pending = true;
+    watchState.known = null;
+    outboxPost('state', 1, null);
+    watchState.timer = setTimeout(function () {
+        console.log('state: no reply from the watch');
+        stateSettled();
+    }, STATE_TIMEOUT);
+}
+
+function acceptState(bytes) {
+    'use strict';
+    watchState.known = {
+        fix: readInt32(bytes, 0),
+        firstDay: bytes[4] | (bytes[5] << 8),
+        count: bytes[6]
+    };
+    console.log('state: ' + JSON.stringify(watchState.known));
+    stateSettled();
 }
 
+function stateSettled() {
+    'use strict';
+    var pos = watchState.deferred;
+    clearTimeout(watchState.timer);
+    watchState.timer = null;
+    watchState.pending = false;
+    watchState.deferred = null;
+    if (pos) {
+        sendLocation(pos);
+    }
+}
+
+/* Whether the watch is known to hold the fix that was last sent, with a
+   sun table that covers the day. */
+function watchHasFix(last, next) {
+    'use strict';
+    var known = watchState.known;
+    return known && last && known.fix === last.fix &&
+        next.day >= known.firstDay && next.day < known.firstDay + known.count;
+}
+
+/* Today's sun events at a fix, in whole minutes UT, along with the day
+   number the watch would start its table from, and the fix timestamp as
+   the watch stores it. */
+function sunSummary(pos) {
+    'use strict';
+    var now = new Date(),
+        year = now.getFullYear(),
+        month = now.getMonth(),
+        date = now.getDate(),
+        sun = sunriset.sun_rise_set(new Date(Date.UTC(year, month, date, 12)),
+                                    pos.coords.longitude, pos.coords.latitude);
+    return {
+        fix: Math.round(pos.timestamp / 1000) | 0,
+        day: Math.floor(Date.UTC(year, month, date) / 86400000),
+        timezone: pos.timezone,
+        rise: Math.round(sun.rise * 60),
+        set: Math.round(sun.set * 60),
+        south: Math.round(sun.south * 60),
+        status: sun.status
+    };
+}
+
+/* Whether the watch already has sun events close enough to these. */
+function sunUnchanged(last, next) {
+    'use strict';
+    return last && last.timezone === next.timezone && last.status === next.status &&
+        next.day - last.day < SUN_TABLE_REFRESH_DAYS && next.day >= last.day &&
+        Math.abs(next.rise - last.rise) < SUN_EVENT_THRESHOLD &&
+        Math.abs(next.set - last.set) < SUN_EVENT_THRESHOLD &&
+        Math.abs(next.south - last.south) < SUN_EVENT_THRESHOLD;
+}
+
+/* Send a fix, unless the watch has the last one sent and it gives the
+   same sun events.  Until the watch has said what it has, the fix
+   waits. */
 function sendLocation(pos) {
     'use strict';
-    var message = locationMessage(pos);
-    Pebble.sendAppMessage(message, function (result) {
-        //console.log('ack tx ' + result.data.transactionId);
-    }, function (result) {
-        console.log(result.data.error.message);
+    if (watchState.pending) {
+        watchState.deferred = pos;
+        return;
+    }
+    var summary = sunSummary(pos),
+        last = retrieveObject('sent-sun', null);
+    if (watchHasFix(last, summary) && sunUnchanged(last, summary)) {
+        console.log('location: sun events unchanged, not sent');
+        return;
+    }
+    outboxPost('location', pos, function () {
+        storeObject('sent-sun', summary);
+        watchState.known = { fix: summary.fix, firstDay: summary.day, count: SUN_TABLE_DAYS };
     });
 }
 
-function locationSuccess(pos) {
+function acceptFix(pos) {
     'use strict';
-    pos.timezone = - new Date().getTimezoneOffset();
+    pos = {
+        timestamp: pos.timestamp,
+        timezone: -new Date().getTimezoneOffset(),
+        coords: {
+            latitude: pos.coords.latitude,
+            longitude: pos.coords.longitude,
+            accuracy: pos.coords.accuracy
+        }
+    };
+    storeObject('last-fix', pos);
     sendLocation(pos);
 }
 
-function locationError(positionError) {
+function fineLocationError(positionError) {
     'use strict';
     console.warn('position error: ', positionError);
+    var last = retrieveObject('last-fix', null);
+    if (last) {
+        last.timezone = -new Date().getTimezoneOffset();
+        sendLocation(last);
+    }
+}
+
+function fineLocationRequest() {
+    'use strict';
+    navigator.geolocation.getCurrentPosition(acceptFix, fineLocationError, FINE_LOCATION_OPTIONS);
+}
+
+function coarseLocationSuccess(pos) {
+    'use strict';
+    if (pos.coords.accuracy > COARSE_ACCURACY_LIMIT) {
+        fineLocationRequest();
+    } else {
+        acceptFix(pos);
+    }
 }
 
 function locationRequest() {
     'use strict';
-    var locationOptions = {
-            'enableHighAccuracy': true,
-            'timeout': 60 * 1000,           // 1 minute (in milliseconds)
-            'maximumAge': 5 * 60 * 1000     // 5 minutes (in milliseconds)
-        };
     if (navigator.geolocation) {
-        //console.log('get current position');
-        navigator.geolocation.getCurrentPosition(locationSuccess, locationError, locationOptions);
+        navigator.geolocation.getCurrentPosition(coarseLocationSuccess, fineLocationRequest,
+                                                 COARSE_LOCATION_OPTIONS);
     } else {
         console.log('location services not available');
     }
@@ -99,6 +428,89 @@ function locationOverride(locopts) {
     return null;
 }
 
+function padLeft(value, width) {
+    'use strict';
+    var text = String(value);
+    while (text.length < width) {
+        text = ' ' + text;
+    }
+    return text;
+}
+
+/* Log the frame timings from the watch as a table of min/mean/max/p95
+   milliseconds per phase. */
+function logProfile(bytes) {
+    'use strict';
+    var phaseCount = bytes[0],
+        frameCount = bytes[1],
+        phase,
+        frame,
+        samples,
+        sample,
+        sum,
+        name;
+    console.log('profile: ' + frameCount + ' frames');
+    console.log(padLeft('phase', 12) + padLeft('n', 5) + padLeft('min', 6) + padLeft('mean', 7) +
+                padLeft('max', 6) + padLeft('p95', 6));
+    for (phase = 0; phase < phaseCount; ++phase) {
+        samples = [];
+        for (frame = 0; frame < frameCount; ++frame) {
+            sample = bytes[2 + frame * phaseCount + phase];
+            if (sample !== PROFILE_SKIPPED) {
+                samples.push(sample);
+            }
+        }
+        name = PROFILE_PHASES[phase] || String(phase);
+        if (samples.length === 0) {
+            console.log(padLeft(name, 12) + padLeft(0, 5));
+            continue;
+        }
+        samples.sort(function (a, b) { return a - b; });
+        sum = samples.reduce(function (a, b) { return a + b; }, 0);
+        console.log(padLeft(name, 12) + padLeft(samples.length, 5) +
+                    padLeft(samples[0], 6) +
+                    padLeft((sum / samples.length).toFixed(1), 7) +
+                    padLeft(samples[samples.length - 1], 6) +
+                    padLeft(samples[Math.min(samples.length - 1, Math.floor(samples.length * 0.95))], 6));
+    }
+}
+
+function requestProfile() {
+    'use strict';
+    outboxPost('profile', 1, null);
+}
+
+/* Log the hourly counters from the watch as CSV, oldest hour first. */
+function logTelemetry(bytes) {
+    'use strict';
+    var counterCount = bytes[0],
+        bucketCount = bytes[1],
+        offset = 2,
+        now = Math.floor(Date.now() / 3600000),
+        hour,
+        bucket,
+        k,
+        row;
+
+    function uint16() {
+        var value = bytes[offset] | (bytes[offset + 1] << 8);
+        offset += 2;
+        return value;
+    }
+
+    console.log('hour,' + TELEMETRY_COUNTERS.slice(0, counterCount).join(','));
+    for (bucket = 0; bucket < bucketCount; ++bucket) {
+        /* The watch keeps the hour modulo 65536, so take the latest hour
+           that matches. */
+        hour = now - (((now - uint16()) % 65536) + 65536) % 65536;
+        row = [new Date(hour * 3600000).toISOString()];
+        for (k = 0; k < counterCount; ++k) {
+            row.push(uint16());
+        }
+        console.log(row.join(','));
+    }
+}
+
 /**
  * Scan over the config and run the callback if the testFn resolves to true
  * @private
@@ -159,11 +571,32 @@ Pebble.addEventListener('ready', function () {
 
     var locopts = retrieveObject('location', null),
         pos = locationOverride(locopts);
+    requestState();
     if (pos) {
         sendLocation(pos);
     } else {
         locationRequest();
     }
+
+    if (PROFILE) {
+        setInterval(requestProfile, PROFILE_INTERVAL);
+    }
+    if (TELEMETRY) {
+        outboxPost('telemetry', 1, null);
+    }
+});
+
+Pebble.addEventListener('appmessage', function (e) {
+    'use strict';
+    if (e.payload.STATE) {
+        acceptState(e.payload.STATE);
+    }
+    if (e.payload.PROFILE) {
+        logProfile(e.payload.PROFILE);
+    }
+    if (e.payload.TELEMETRY) {
+        logTelemetry(e.payload.TELEMETRY);
+    }
 });
 
 Pebble.addEventListener('showConfiguration', function(e) {
@@ -179,10 +612,10 @@ Pebble.addEventListener("webviewclosed", function (e) {
     var k,
         dict = clay.getSettings(e.response),
         userData = clay.getUserData(e.response),
-        message = {
-            'BLUETOOTH': parseInt(dict[keys.BLUETOOTH], 10),
-            'BATTERY': !!dict[keys.BATTERY],
-            'PALETTE': []
+        config = {
+            bluetooth: parseInt(dict[keys.BLUETOOTH], 10),
+            battery: !!dict[keys.BATTERY],
+            palette: []
         },
         locopts = {
             automatic: true /* !!dict[keys.LOCATION],
@@ -199,25 +632,19 @@ Pebble.addEventListener("webviewclosed", function (e) {
 
     storeObject('location', locopts);
     var locpos = locationOverride(locopts);
-    if (locpos) {
-        var locmsg = locationMessage(locpos);
-        _.extendOwn(message, locmsg);
-    } else {
+    if (!locpos) {
         locationRequest();
     }
 
     for (k = 0; k < 12; ++k) {
-        message.PALETTE.push(colors.eightBitColorFromInt(dict[keys.COLORS + k]));
+        config.palette.push(colors.eightBitColorFromInt(dict[keys.COLORS + k]));
     }
 
-    console.log(JSON.stringify(message, null, 2));
-
-    Pebble.sendAppMessage(message, function(e) {
-        //console.log('Sent config data to Pebble');
-    }, function(e) {
-        console.log('Failed to send config data!');
-        console.log(JSON.stringify(e));
-    });
+    console.log(JSON.stringify(config, null, 2));
+    outboxPost('config', config, null);
+    if (locpos) {
+        outboxPost('location', locpos, null);
+    }
 });
 
 // ---------------------------------------------------------------------------
@@ -0,0 +1,294 @@
+#!/usr/bin/env python
+#
+# Pre-rasterize the time readout glyphs ("0" to "9" and ":") of the
+# DIN Condensed SVG font into an anti-aliased alpha atlas, one per
+# target platform, at the cap height the face uses for the time.
+#
+# usage: digit-atlas.py resources.svg resources/data
+#
+# Atlas format (little endian):
+#
+#   uint8   version
+#   uint8   capHeight       pixels, must match the runtime layout
+#   uint8   cellHeight      rows in every glyph cell
+#   uint8   baseline        row of the baseline, counted from the cell top
+#   uint8   glyphCount
+#   glyphCount x {
+#     uint8   code          character code
+#     uint8   width         columns in the glyph cell
+#     int8    left          cell column 0, relative to the pen, pixels
+#     uint8   reserved
+#     uint16  advance       pen advance, fctx fixed point (1/16 pixel)
+#     uint16  offset        byte offset of the cell bitmap in the atlas
+#   }
+#   cell bitmaps, rows of (width + 3) / 4 bytes, 2 bits of coverage per
+#   pixel, first pixel in the least significant bits.
+#
+
+from __future__ import division, print_function
+
+import math
+import os
+import re
+import struct
+import sys
+import xml.etree.ElementTree as ET
+
+ATLAS_VERSION = 1
+GLYPHS = '0123456789:'
+SUPERSAMPLE = 4
+FIXED_POINT_SCALE = 16
+
+PLATFORMS = {
+    # name: (width, height, round)
+    'aplite': (144, 168, False),
+    'basalt': (144, 168, False),
+    'chalk': (180, 180, True),
+    'diorite': (144, 168, False),
+    'emery': (200, 228, False),
+}
+
+
+def time_cap_height(width, height, is_round):
+    """Mirror the layout calculation in tools/layout-tables.py."""
+    design_radius = min(width, height) // 2 - (4 if is_round else 0)
+    sun_disc_radius = design_radius * 3 // 25
+    sun_disc_margin = sun_disc_radius * 1 // 3
+    sun_orbit_radius = design_radius - sun_disc_margin - sun_disc_radius
+    readout_disc_radius = sun_orbit_radius - sun_disc_radius - sun_disc_margin
+    return (readout_disc_radius * 10 // 21) // 2 * 2
+
+
+# --------------------------------------------------------------------------
+# SVG font parsing
+# --------------------------------------------------------------------------
+
+def tokenize_path(d):
+    for match in re.finditer(r'([MmLlHhVvQqTtCcSsZz])|([-+]?(?:\d+\.?\d*|\.\d+)(?:[eE][-+]?\d+)?)', d):
+        if match.group(1):
+            yield match.group(1)
+        else:
+            yield float(match.group(2))
+
+
+def flatten_path(d, steps=8):
+    """Convert an SVG path into a list of closed polygons."""
+    tokens = list(tokenize_path(d))
+    polygons = []
+    polygon = []
+    x = y = 0.0
+    start = (0.0, 0.0)
+    control = None
+    command = None
+    i = 0
+
+    def take(n):
+        values = tokens[i:i + n]
+        return values, i + n
+
+    def quadratic(p0, p1, p2):
+        for k in range(1, steps + 1):
+            t = k / steps
+            u = 1 - t
+            polygon.append((u * u * p0[0] + 2 * u * t * p1[0] + t * t * p2[0],
+                            u * u * p0[1] + 2 * u * t * p1[1] + t * t * p2[1]))
+
+    def cubic(p0, p1, p2, p3):
+        for k in range(1, steps + 1):
+            t = k / steps
+            u = 1 - t
+            polygon.append((u * u * u * p0[0] + 3 * u * u * t * p1[0] + 3 * u * t * t * p2[0] + t * t * t * p3[0],
+                            u * u * u * p0[1] + 3 * u * u * t * p1[1] + 3 * u * t * t * p2[1] + t * t * t * p3[1]))
+
+    while i < len(tokens):
+        if isinstance(tokens[i], str):
+            command = tokens[i]
+            i += 1
+            if command in 'Zz':
+                if polygon:
+                    polygons.append(polygon)
+                polygon = []
+                x, y = start
+                control = None
+                continue
+        relative = command.islower()
+        ox, oy = (x, y) if relative else (0.0, 0.0)
+        op = command.upper()
+        if op == 'M':
+            (px, py), i = take(2)
+            if polygon:
+                polygons.append(polygon)
+            x, y = ox + px, oy + py
+            start = (x, y)
+            polygon = [(x, y)]
+            command = 'l' if relative else 'L'
+            control = None
+        elif op == 'L':
+            (px, py), i = take(2)
+            x, y = ox + px, oy + py
+            polygon.append((x, y))
+            control = None
+        elif op == 'H':
+            (px,), i = take(1)
+            x = ox + px
+            polygon.append((x, y))
+            control = None
+        elif op == 'V':
+            (py,), i = take(1)
+            y = oy + py
+            polygon.append((x, y))
+            control = None
+        elif op == 'Q':
+            (cx, cy, px, py), i = take(4)
+            c = (ox + cx, oy + cy)
+            quadratic((x, y), c, (ox + px, oy + py))
+            x, y = ox + px, oy + py
+            control = ('Q', c)
+        elif op == 'T':
+            (px, py), i = take(2)
+            if control and control[0] == 'Q':
+                c = (2 * x - control[1][0], 2 * y - control[1][1])
+            else:
+                c = (x, y)
+            quadratic((x, y), c, (ox + px, oy + py))
+            x, y = ox + px, oy + py
+            control = ('Q', c)
+        elif op == 'C':
+            (c1x, c1y, c2x, c2y, px, py), i = take(6)
+            c2 = (ox + c2x, oy + c2y)
+            cubic((x, y), (ox + c1x, oy + c1y), c2, (ox + px, oy + py))
+            x, y = ox + px, oy + py
+            control = ('C', c2)
+        elif op == 'S':
+            (c2x, c2y, px, py), i = take(4)
+            if control and control[0] == 'C':
+                c1 = (2 * x - control[1][0], 2 * y - control[1][1])
+            else:
+                c1 = (x, y)
+            c2 = (ox + c2x, oy + c2y)
+            cubic((x, y), c1, c2, (ox + px, oy + py))
+            x, y = ox + px, oy + py
+            control = ('C', c2)
+        else:
+            raise ValueError('unsupported path command ' + command)
+
+    if polygon:
+        polygons.append(polygon)
+    return polygons
+
+
+def load_glyphs(svg_path):
+    tree = ET.parse(svg_path)
+    ns = {'svg': 'http://www.w3.org/2000/svg'}
+    font = tree.find('.//svg:font', ns)
+    face = font.find('svg:font-face', ns)
+    default_advance = float(font.get('horiz-adv-x'))
+    cap_height = float(face.get('cap-height'))
+    glyphs = {}
+    for glyph in font.findall('svg:glyph', ns):
+        code = glyph.get('unicode')
+        if code and code in GLYPHS:
+            advance = float(glyph.get('horiz-adv-x', default_advance))
+            glyphs[code] = (advance, flatten_path(glyph.get('d', '')))
+    return cap_height, glyphs
+
+
+# --------------------------------------------------------------------------
+# Rasterization
+# --------------------------------------------------------------------------
+
+def coverage(polygons, width, height, transform):
+    """Nonzero winding coverage, 0 to SUPERSAMPLE^2, per pixel."""
+    edges = []
+    for polygon in polygons:
+        points = [transform(p) for p in polygon]
+        for k in range(len(points)):
+            (x0, y0), (x1, y1) = points[k], points[(k + 1) % len(points)]
+            if y0 != y1:
+                edges.append((x0, y0, x1, y1))
+
+    cells = [[0] * width for _ in range(height)]
+    for row in range(height):
+        for sy in range(SUPERSAMPLE):
+            y = row + (sy + 0.5) / SUPERSAMPLE
+            crossings = []
+            for x0, y0, x1, y1 in edges:
+                if (y0 <= y < y1) or (y1 <= y < y0):
+                    x = x0 + (y - y0) * (x1 - x0) / (y1 - y0)
+                    crossings.append((x, 1 if y1 > y0 else -1))
+            crossings.sort()
+            winding = 0
+            for k, (x, direction) in enumerate(crossings):
+                winding += direction
+                if winding != 0 and k + 1 < len(crossings):
+                    left, right = x, crossings[k + 1][0]
+                    for sx in range(SUPERSAMPLE * width):
+                        px = (sx + 0.5) / SUPERSAMPLE
+                        if left <= px < right:
+                            cells[row][sx // SUPERSAMPLE] += 1
+    return cells
+
+
+def build_atlas(cap_pixels, cap_height, glyphs):
+    scale = cap_pixels / cap_height
+
+    # One cell height for every glyph, from the union of their extents.
+    top = max(p[1] for code in GLYPHS for poly in glyphs[code][1] for p in poly)
+    bottom = min(p[1] for code in GLYPHS for poly in glyphs[code][1] for p in poly)
+    above = int(math.ceil(top * scale))
+    below = int(math.ceil(-bottom * scale))
+    cell_height = above + below
+    baseline = above
+
+    header = struct.pack('<BBBBB', ATLAS_VERSION, cap_pixels, cell_height, baseline, len(GLYPHS))
+    directory = b''
+    bitmaps = b''
+    data_offset = len(header) + len(GLYPHS) * 8
+
+    for code in GLYPHS:
+        advance, polygons = glyphs[code]
+        xs = [p[0] for poly in polygons for p in poly]
+        left = int(math.floor(min(xs) * scale))
+        right = int(math.ceil(max(xs) * scale))
+        width = right - left
+
+        def transform(p, left=left):
+            return (p[0] * scale - left, baseline - p[1] * scale)
+
+        cells = coverage(polygons, width, cell_height, transform)
+        full = SUPERSAMPLE * SUPERSAMPLE
+        row_bytes = (width + 3) // 4
+        bitmap = bytearray()
+        for row in cells:
+            packed = bytearray(row_bytes)
+            for x, samples in enumerate(row):
+                alpha = (samples * 3 + full // 2) // full
+                packed[x // 4] |= alpha << ((x % 4) * 2)
+            bitmap += packed
+
+        fixed_advance = int(round(advance * scale * FIXED_POINT_SCALE))
+        directory += struct.pack('<BBbBHH', ord(code), width, left, 0, fixed_advance,
+                                 data_offset + len(bitmaps))
+        bitmaps += bytes(bitmap)
+
+    return header + directory + bitmaps
+
+
+def main(argv):
+    if len(argv) != 3:
+        print('usage: digit-atlas.py resources.svg output-directory', file=sys.stderr)
+        return 1
+    cap_height, glyphs = load_glyphs(argv[1])
+    for platform in sorted(PLATFORMS):
+        width, height, is_round = PLATFORMS[platform]
+        cap_pixels = time_cap_height(width, height, is_round)
+        atlas = build_atlas(cap_pixels, cap_height, glyphs)
+        path = os.path.join(argv[2], 'digits~{}.atlas'.format(platform))
+        with open(path, 'wb') as f:
+            f.write(atlas)
+        print('{}: {} px cap height, {} bytes'.format(path, cap_pixels, len(atlas)))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
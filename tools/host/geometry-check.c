@@ -0,0 +1,292 @@
+/*
+ * Check the fixed point geometry of src/c/geometry.h, the integer square
+ * root and the span ring fill against double precision references, over
+ * every radius and angle the layouts of the target platform use, and
+ * time each of them.  Exits non-zero if any result is outside the limits
+ * documented in the headers.
+ *
+ * The stub trig tables round the exact sine and cosine, so the limits
+ * checked here exclude the error of the watch's own tables.
+ */
+
+#define HOST_RUNNER
+#include "pebble.h"
+#include <math.h>
+#include "geometry.h"
+#include "layout.h"
+#include "spans.h"
+
+static int failures;
+
+static void check(bool ok, const char* what, double worst, double limit) {
+    printf("  %-34s worst %8.4f  limit %8.4f  %s\n", what, worst, limit, ok ? "ok" : "FAIL");
+    if (!ok) {
+        ++failures;
+    }
+}
+
+static uint64_t nanoseconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static void timing(const char* what, uint64_t start, uint64_t calls) {
+    printf("  %-34s %8.2f ns/call\n", what, (double)(nanoseconds() - start) / calls);
+}
+
+/* Keeps the timed loops from being optimized away. */
+static volatile int32_t sink;
+
+// --------------------------------------------------------------------------
+// Radii and angles
+// --------------------------------------------------------------------------
+
+/* Every radius the full layout draws with, in fixed point, and the
+   largest of them in whole pixels.  Obstructed layouts are smaller, and
+   are covered by the sweeps up to the largest radius. */
+static fixed_t radii[8];
+static int radiusCount;
+static int32_t maxRadius;
+
+static void collectRadii() {
+    const Layout* l = &kFullLayout;
+    fixed_t all[] = {
+        l->sunDiscRadius, l->sunDiscRadius - l->strokeWidth / 2, l->sunDiscRadius - l->strokeWidth,
+        l->hourPipRadius, l->sunOrbitRadius,
+        l->readoutDiscRadius, l->readoutDiscRadius - l->strokeWidth / 2, l->readoutDiscRadius - l->strokeWidth,
+    };
+    for (size_t k = 0; k < ARRAY_LENGTH(all); ++k) {
+        radii[radiusCount++] = all[k];
+        if (FIXED_TO_INT(all[k]) + 1 > maxRadius) {
+            maxRadius = FIXED_TO_INT(all[k]) + 1;
+        }
+    }
+}
+
+// --------------------------------------------------------------------------
+// Checks
+// --------------------------------------------------------------------------
+
+static void checkSqrt() {
+    puts("usqrt");
+    double worstLow = 0, worstHigh = 0;
+    for (uint64_t x = 0; x <= UINT32_MAX; x += (x < (1u << 28)) ? 13 : 101) {
+        double exact = floorl(sqrtl((long double)x) * SQRT_SCALE);
+        double error = fabs(exact - usqrt((uint32_t)x));
+        if (x < (1u << 28)) {
+            worstLow = fmax(worstLow, error);
+        } else {
+            worstHigh = fmax(worstHigh, error);
+        }
+    }
+    check(worstLow == 0, "below 2^28, 1/65536", worstLow, 0);
+    check(worstHigh <= 3, "above 2^28, 1/65536", worstHigh, 3);
+
+    uint64_t start = nanoseconds();
+    uint32_t calls = 0;
+    for (uint32_t x = 1; x < (1u << 24); x += 7, ++calls) {
+        sink += usqrt(x);
+    }
+    timing("usqrt", start, calls);
+    start = nanoseconds();
+    calls = 0;
+    for (uint32_t x = 1; x < (1u << 24); x += 7, ++calls) {
+        sink += (int32_t)(sqrt(x) * SQRT_SCALE);
+    }
+    timing("libm sqrt, for scale", start, calls);
+}
+
+static void checkChords() {
+    puts("circle_chord and arc_chords");
+    double worst = 0;
+    for (int32_t r = 1; r <= INT_TO_FIXED(maxRadius); ++r) {
+        for (int32_t dy = -r - FIX1; dy <= r + FIX1; ++dy) {
+            double h = (double)r * r - (double)dy * dy;
+            int32_t exact = h > 0 ? (int32_t)floor(sqrt(h)) : -1;
+            worst = fmax(worst, abs(exact - circle_chord(r, dy)));
+        }
+    }
+    check(worst == 0, "circle_chord, 1/16 px", worst, 0);
+
+    worst = 0;
+    for (int32_t r = 1; r <= maxRadius; ++r) {
+        fixed_t chords[16];
+        arc_chords(r, ARRAY_LENGTH(chords), chords);
+        for (int k = 0; k < (int)ARRAY_LENGTH(chords); ++k) {
+            double exact = floor(sqrt((double)k * (2 * r - k)) * FIXED_POINT_SCALE);
+            worst = fmax(worst, fabs(exact - chords[k]));
+        }
+    }
+    check(worst == 0, "arc_chords, 1/16 px", worst, 0);
+
+    uint64_t start = nanoseconds();
+    uint32_t calls = 0;
+    for (int n = 0; n < 200; ++n) {
+        for (int k = 0; k < radiusCount; ++k) {
+            for (int32_t dy = -radii[k]; dy <= radii[k]; dy += FIX1, ++calls) {
+                sink += circle_chord(radii[k], dy);
+            }
+        }
+    }
+    timing("circle_chord", start, calls);
+}
+
+static void checkPoints() {
+    puts("clock_point, clock_points and chord_midpoint_row");
+    double worstPoint = 0;
+    for (int k = 0; k < radiusCount; ++k) {
+        for (int32_t angle = 0; angle < TRIG_MAX_ANGLE; angle += 7) {
+            FPoint p = clock_point(FPointZero, radii[k], angle);
+            double a = angle * 2 * M_PI / TRIG_MAX_ANGLE;
+            worstPoint = fmax(worstPoint, fabs(p.x + radii[k] * sin(a)));
+            worstPoint = fmax(worstPoint, fabs(p.y - radii[k] * cos(a)));
+        }
+    }
+    check(worstPoint < 2, "clock_point, 1/16 px", worstPoint, 2);
+
+    double worstPoints = 0;
+    for (int k = 0; k < radiusCount; ++k) {
+        for (int32_t rotation = 0; rotation < TRIG_MAX_ANGLE; rotation += 61) {
+            FPoint points[ARRAY_LENGTH(kHourUnit)];
+            clock_points(FPointZero, radii[k], kHourUnit, ARRAY_LENGTH(kHourUnit),
+                         rotation_from_angle(rotation), points);
+            for (size_t h = 0; h < ARRAY_LENGTH(kHourUnit); ++h) {
+                double a = (hour_angle(h) + rotation) * 2 * M_PI / TRIG_MAX_ANGLE;
+                worstPoints = fmax(worstPoints, fabs(points[h].x + radii[k] * sin(a)));
+                worstPoints = fmax(worstPoints, fabs(points[h].y - radii[k] * cos(a)));
+            }
+        }
+    }
+    check(worstPoints < 3, "clock_points, 1/16 px", worstPoints, 3);
+
+    /* Rounded to the nearest row, so within half a row of the exact
+       midpoint, plus the error of the points. */
+    double worstRow = 0;
+    fixed_t orbit = kFullLayout.sunOrbitRadius;
+    for (int32_t a0 = 0; a0 < TRIG_MAX_ANGLE; a0 += 251) {
+        for (int32_t a1 = 0; a1 < TRIG_MAX_ANGLE; a1 += 257) {
+            double exact = orbit * (cos(a0 * 2 * M_PI / TRIG_MAX_ANGLE)
+                                    + cos(a1 * 2 * M_PI / TRIG_MAX_ANGLE)) / 2 / FIXED_POINT_SCALE;
+            worstRow = fmax(worstRow, fabs(chord_midpoint_row(orbit, a0, a1) - exact));
+        }
+    }
+    check(worstRow <= 0.5 + 1.0 / FIXED_POINT_SCALE, "chord_midpoint_row, px", worstRow,
+          0.5 + 1.0 / FIXED_POINT_SCALE);
+
+    uint64_t start = nanoseconds();
+    uint32_t calls = 0;
+    for (int n = 0; n < 20; ++n) {
+        for (int32_t angle = 0; angle < TRIG_MAX_ANGLE; angle += 97, ++calls) {
+            sink += clock_point(FPointZero, kFullLayout.sunOrbitRadius, angle).x;
+        }
+    }
+    timing("clock_point", start, calls);
+    start = nanoseconds();
+    calls = 0;
+    for (int32_t rotation = 0; rotation < TRIG_MAX_ANGLE; rotation += 97, ++calls) {
+        FPoint points[ARRAY_LENGTH(kHourUnit)];
+        clock_points(FPointZero, kFullLayout.sunOrbitRadius, kHourUnit, ARRAY_LENGTH(kHourUnit),
+                     rotation_from_angle(rotation), points);
+        sink += points[0].x;
+    }
+    timing("clock_points, all hours", start, calls);
+}
+
+#if !defined(PBL_BW)
+/* The coverage level, 0 to 3, of a ring over one pixel, by supersampling. */
+static int ringLevel(double cx, double cy, double outer, double inner, int x, int y) {
+    int inside = 0;
+    for (int sy = 0; sy < 16; ++sy) {
+        for (int sx = 0; sx < 16; ++sx) {
+            double dx = x + (sx + 0.5) / 16 - cx;
+            double dy = y + (sy + 0.5) / 16 - cy;
+            double d = sqrt(dx * dx + dy * dy);
+            inside += d <= outer && d > inner;
+        }
+    }
+    return (int)lround(inside * 3.0 / 256);
+}
+#endif
+
+static void checkRings() {
+    puts("span_fill_ring");
+    GBitmap* fb = host_frame_buffer();
+    GRect bounds = gbitmap_get_bounds(fb);
+    GColor white = GColorWhite;
+    double worstAliased = 0;
+#if !defined(PBL_BW)
+    double worstLevel = 0;
+#endif
+    srand(1);
+    for (int n = 0; n < 400; ++n) {
+        FPoint center = FPoint(INT_TO_FIXED(bounds.size.w / 2) + rand() % FIX1,
+                               INT_TO_FIXED(bounds.size.h / 2) + rand() % FIX1);
+        fixed_t outer = radii[n % radiusCount] + rand() % FIX1;
+        fixed_t inner = (n & 1) ? outer - kFullLayout.strokeWidth : 0;
+        for (int aa = 0; aa < 2; ++aa) {
+            span_enable_aa(aa);
+            span_fill_rect(fb, bounds, GColorBlack);
+            span_fill_ring(fb, center, outer, inner, white);
+            int32_t reach = FIXED_TO_INT(outer) + 2;
+            for (int y = FIXED_TO_INT(center.y) - reach; y <= FIXED_TO_INT(center.y) + reach; ++y) {
+                GBitmapDataRowInfo row = gbitmap_get_data_row_info(fb, y);
+                for (int x = FIXED_TO_INT(center.x) - reach; x <= FIXED_TO_INT(center.x) + reach; ++x) {
+#if defined(PBL_BW)
+                    int level = (row.data[x / 8] >> (x % 8)) & 1 ? 3 : 0;
+#else
+                    int level = row.data[x] & 3;
+#endif
+                    if (aa) {
+#if !defined(PBL_BW)
+                        double cx = center.x / 16.0, cy = center.y / 16.0;
+                        int expected = ringLevel(cx, cy, outer / 16.0, inner / 16.0, x, y);
+                        worstLevel = fmax(worstLevel, abs(level - expected));
+#endif
+                    } else {
+                        /* Filled if and only if the pixel center is inside. */
+                        int32_t dx = INT_TO_FIXED(x) + FIX1 / 2 - center.x;
+                        int32_t dy = INT_TO_FIXED(y) + FIX1 / 2 - center.y;
+                        int32_t reachX = circle_chord(outer, dy);
+                        int32_t hole = inner > 0 ? circle_chord(inner, dy) : -1;
+                        bool inside = abs(dx) <= reachX && abs(dx) > hole;
+                        worstAliased = fmax(worstAliased, inside != (level != 0));
+                    }
+                }
+            }
+        }
+    }
+    span_enable_aa(true);
+    check(worstAliased == 0, "aliased, pixel centers inside", worstAliased, 0);
+#if !defined(PBL_BW)
+    check(worstLevel <= 1, "antialiased, coverage levels", worstLevel, 1);
+#endif
+
+    uint64_t start = nanoseconds();
+    uint32_t calls = 0;
+    for (int n = 0; n < 200; ++n, ++calls) {
+        span_fill_ring(fb, FPoint(INT_TO_FIXED(bounds.size.w / 2), INT_TO_FIXED(bounds.size.h / 2)),
+                       kFullLayout.readoutDiscRadius, kFullLayout.readoutDiscRadius - kFullLayout.strokeWidth,
+                       white);
+    }
+    timing("readout ring, antialiased", start, calls);
+    start = nanoseconds();
+    calls = 0;
+    for (int n = 0; n < 200; ++n, ++calls) {
+        span_fill_ring(fb, FPoint(INT_TO_FIXED(bounds.size.w / 2), INT_TO_FIXED(bounds.size.h / 2)),
+                       kFullLayout.readoutDiscRadius, 0, white);
+    }
+    timing("readout disc, antialiased", start, calls);
+}
+
+int main(void) {
+    collectRadii();
+    checkSqrt();
+    checkChords();
+    checkPoints();
+    checkRings();
+    if (failures) {
+        printf("%d checks failed\n", failures);
+    }
+    return failures ? 1 : 0;
+}
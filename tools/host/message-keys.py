@@ -0,0 +1,40 @@
+#!/usr/bin/env python
+#
+# Number the message keys of package.json the way the SDK does, as the
+# header of MESSAGE_KEY_ constants the stub SDK includes.  An array key
+# such as COLORS[12] takes that many consecutive numbers.
+#
+# usage: message-keys.py package.json output.h
+#
+
+from __future__ import division, print_function
+
+import json
+import re
+import sys
+
+FIRST_KEY = 10000
+
+ARRAY_KEY = re.compile(r'^(\w+)\[(\d+)\]$')
+
+
+def main(argv):
+    if len(argv) != 3:
+        print('usage: message-keys.py package.json output.h', file=sys.stderr)
+        return 1
+    with open(argv[1]) as f:
+        keys = json.load(f)['pebble']['messageKeys']
+    number = FIRST_KEY
+    with open(argv[2], 'w') as out:
+        out.write('/* Generated by tools/host/message-keys.py.  Do not edit. */\n\n')
+        out.write('#pragma once\n\n')
+        for key in keys:
+            match = ARRAY_KEY.match(key)
+            name, count = (match.group(1), int(match.group(2))) if match else (key, 1)
+            out.write('#define MESSAGE_KEY_{} {}\n'.format(name, number))
+            number += count
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
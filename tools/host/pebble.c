@@ -0,0 +1,942 @@
+/*
+ * The stub SDK behind pebble.h.  Just enough of the firmware to run the
+ * face on a desktop machine: a framebuffer in the platform's format, a
+ * layer tree that repaints the way the firmware does, timers and
+ * animations on a virtual clock, in-memory persistence, and resources
+ * read from resources/data.  Services are accepted and never fire.
+ */
+
+#define HOST_RUNNER
+#include "pebble.h"
+#include <math.h>
+#include <stdarg.h>
+
+HostOptions host_options = { .resources = "resources/data" };
+HostStats host_stats;
+
+// --------------------------------------------------------------------------
+// Clock
+// --------------------------------------------------------------------------
+
+/* Milliseconds since the runner started, plus however far the event loop
+   has skipped ahead to the next timer.  Drawing costs real time; waiting
+   for a timer does not. */
+static uint64_t clockOffset;
+
+static uint64_t nanoseconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static uint64_t clockStart;
+
+static uint64_t clockNow() {
+    if (!clockStart) {
+        clockStart = nanoseconds();
+    }
+    return (nanoseconds() - clockStart) / 1000000u + clockOffset;
+}
+
+uint16_t time_ms(time_t* t_utc, uint16_t* out_ms) {
+    uint64_t now = clockNow();
+    if (t_utc) *t_utc = (time_t)(now / 1000);
+    if (out_ms) *out_ms = now % 1000;
+    return now % 1000;
+}
+
+bool clock_is_24h_style(void) { return false; }
+bool clock_is_timezone_set(void) { return false; }
+
+void clock_get_timezone(char* timezone, const size_t buffer_size) {
+    snprintf(timezone, buffer_size, "UTC");
+}
+
+// --------------------------------------------------------------------------
+// Math
+// --------------------------------------------------------------------------
+
+int32_t sin_lookup(int32_t angle) {
+    return (int32_t)lround(sin(angle * (2 * M_PI / TRIG_MAX_ANGLE)) * TRIG_MAX_RATIO);
+}
+
+int32_t cos_lookup(int32_t angle) {
+    return (int32_t)lround(cos(angle * (2 * M_PI / TRIG_MAX_ANGLE)) * TRIG_MAX_RATIO);
+}
+
+int32_t atan2_lookup(int16_t y, int16_t x) {
+    double a = atan2(y, x);
+    if (a < 0) a += 2 * M_PI;
+    return (int32_t)lround(a * (TRIG_MAX_ANGLE / (2 * M_PI))) % TRIG_MAX_ANGLE;
+}
+
+// --------------------------------------------------------------------------
+// Geometry
+// --------------------------------------------------------------------------
+
+bool gcolor_equal(GColor8 a, GColor8 b) {
+    return a.argb == b.argb || (a.a == 0 && b.a == 0);
+}
+
+bool gpoint_equal(const GPoint* a, const GPoint* b) {
+    return a->x == b->x && a->y == b->y;
+}
+
+bool gsize_equal(const GSize* a, const GSize* b) {
+    return a->w == b->w && a->h == b->h;
+}
+
+bool grect_equal(const GRect* a, const GRect* b) {
+    return gpoint_equal(&a->origin, &b->origin) && gsize_equal(&a->size, &b->size);
+}
+
+bool grect_is_empty(const GRect* rect) {
+    return rect->size.w == 0 || rect->size.h == 0;
+}
+
+void grect_standardize(GRect* rect) {
+    if (rect->size.w < 0) {
+        rect->origin.x += rect->size.w;
+        rect->size.w = -rect->size.w;
+    }
+    if (rect->size.h < 0) {
+        rect->origin.y += rect->size.h;
+        rect->size.h = -rect->size.h;
+    }
+}
+
+void grect_clip(GRect* rect, const GRect* clipper) {
+    int16_t x0 = rect->origin.x > clipper->origin.x ? rect->origin.x : clipper->origin.x;
+    int16_t y0 = rect->origin.y > clipper->origin.y ? rect->origin.y : clipper->origin.y;
+    int16_t x1 = rect->origin.x + rect->size.w;
+    int16_t y1 = rect->origin.y + rect->size.h;
+    int16_t cx1 = clipper->origin.x + clipper->size.w;
+    int16_t cy1 = clipper->origin.y + clipper->size.h;
+    if (x1 > cx1) x1 = cx1;
+    if (y1 > cy1) y1 = cy1;
+    *rect = GRect(x0, y0, x1 > x0 ? x1 - x0 : 0, y1 > y0 ? y1 - y0 : 0);
+}
+
+bool grect_contains_point(const GRect* rect, const GPoint* point) {
+    return point->x >= rect->origin.x && point->x < rect->origin.x + rect->size.w
+        && point->y >= rect->origin.y && point->y < rect->origin.y + rect->size.h;
+}
+
+GPoint grect_center_point(const GRect* rect) {
+    return GPoint(rect->origin.x + rect->size.w / 2, rect->origin.y + rect->size.h / 2);
+}
+
+GRect grect_inset(GRect rect, int16_t inset) {
+    return GRect(rect.origin.x + inset, rect.origin.y + inset,
+                 rect.size.w - 2 * inset, rect.size.h - 2 * inset);
+}
+
+// --------------------------------------------------------------------------
+// Bitmaps
+// --------------------------------------------------------------------------
+
+struct GBitmap {
+    uint8_t* data;
+    uint16_t stride;
+    GRect bounds;
+    GBitmapFormat format;
+    bool circular;
+};
+
+/* The visible span of each row of the round display. */
+static void circularSpan(const GBitmap* bitmap, int16_t y, int16_t* min_x, int16_t* max_x) {
+    double r = bitmap->bounds.size.w / 2.0;
+    double dy = y + 0.5 - bitmap->bounds.size.h / 2.0;
+    double half = dy * dy < r * r ? sqrt(r * r - dy * dy) : 0;
+    *min_x = (int16_t)floor(r - half + 0.5);
+    *max_x = (int16_t)ceil(r + half - 0.5) - 1;
+    if (*max_x < *min_x) *max_x = *min_x;
+}
+
+static GBitmap* createBitmap(GSize size, GBitmapFormat format) {
+    GBitmap* bitmap = calloc(1, sizeof(GBitmap));
+    bitmap->format = format;
+    bitmap->bounds = GRect(0, 0, size.w, size.h);
+    if (format == GBitmapFormat1Bit) {
+        bitmap->stride = ((size.w + 31) / 32) * 4;
+    } else {
+        bitmap->stride = size.w;
+    }
+    bitmap->data = calloc(bitmap->stride, size.h);
+    return bitmap;
+}
+
+GBitmap* gbitmap_create_blank(GSize size, GBitmapFormat format) {
+    if (format == GBitmapFormat8BitCircular) {
+        format = GBitmapFormat8Bit;
+    }
+    return createBitmap(size, format);
+}
+
+void gbitmap_destroy(GBitmap* bitmap) {
+    if (bitmap) {
+        free(bitmap->data);
+        free(bitmap);
+    }
+}
+
+GRect gbitmap_get_bounds(const GBitmap* bitmap) { return bitmap->bounds; }
+GBitmapFormat gbitmap_get_format(const GBitmap* bitmap) { return bitmap->format; }
+uint8_t* gbitmap_get_data(const GBitmap* bitmap) { return bitmap->data; }
+
+uint16_t gbitmap_get_bytes_per_row(const GBitmap* bitmap) {
+    return bitmap->circular ? 0 : bitmap->stride;
+}
+
+GBitmapDataRowInfo gbitmap_get_data_row_info(const GBitmap* bitmap, uint16_t y) {
+    GBitmapDataRowInfo info = {
+        .data = bitmap->data + y * bitmap->stride,
+        .min_x = 0,
+        .max_x = bitmap->bounds.size.w - 1,
+    };
+    if (bitmap->circular) {
+        circularSpan(bitmap, y, &info.min_x, &info.max_x);
+    }
+    return info;
+}
+
+static GBitmap* frameBuffer;
+
+GBitmap* host_frame_buffer(void) {
+    if (!frameBuffer) {
+        GSize size = GSize(PBL_DISPLAY_WIDTH, PBL_DISPLAY_HEIGHT);
+#if defined(PBL_BW)
+        frameBuffer = createBitmap(size, GBitmapFormat1Bit);
+#else
+        frameBuffer = createBitmap(size, GBitmapFormat8Bit);
+#endif
+#if defined(PBL_ROUND)
+        frameBuffer->format = GBitmapFormat8BitCircular;
+        frameBuffer->circular = true;
+#endif
+    }
+    return frameBuffer;
+}
+
+// --------------------------------------------------------------------------
+// Graphics context
+// --------------------------------------------------------------------------
+
+struct GContext {
+    GRect frame;        // of the layer being drawn, in screen coordinates
+    GColor fill;
+    GColor stroke;
+    GColor text;
+    bool captured;
+};
+
+static GContext context;
+
+GBitmap* graphics_capture_frame_buffer(GContext* ctx) {
+    if (ctx->captured) {
+        return NULL;
+    }
+    ctx->captured = true;
+    return host_frame_buffer();
+}
+
+GBitmap* graphics_capture_frame_buffer_format(GContext* ctx, GBitmapFormat format) {
+    return graphics_capture_frame_buffer(ctx);
+}
+
+bool graphics_release_frame_buffer(GContext* ctx, GBitmap* buffer) {
+    bool captured = ctx->captured;
+    ctx->captured = false;
+    return captured;
+}
+
+bool graphics_frame_buffer_is_captured(GContext* ctx) { return ctx->captured; }
+
+void graphics_context_set_fill_color(GContext* ctx, GColor color) { ctx->fill = color; }
+void graphics_context_set_stroke_color(GContext* ctx, GColor color) { ctx->stroke = color; }
+void graphics_context_set_text_color(GContext* ctx, GColor color) { ctx->text = color; }
+void graphics_context_set_antialiased(GContext* ctx, bool enable) {}
+void graphics_context_set_compositing_mode(GContext* ctx, GCompOp mode) {}
+
+#if defined(PBL_BW)
+/* The display maps colors to black and white by brightness. */
+static bool whitePixel(GColor color) {
+    return color.r + color.g + color.b >= 5;
+}
+#endif
+
+static void fillScreenRect(GRect rect, GColor color) {
+    if (color.a == 0) {
+        return;
+    }
+    GBitmap* fb = host_frame_buffer();
+    grect_clip(&rect, &fb->bounds);
+    for (int16_t y = rect.origin.y; y < rect.origin.y + rect.size.h; ++y) {
+        GBitmapDataRowInfo row = gbitmap_get_data_row_info(fb, y);
+        int16_t x0 = rect.origin.x > row.min_x ? rect.origin.x : row.min_x;
+        int16_t x1 = rect.origin.x + rect.size.w - 1;
+        if (x1 > row.max_x) x1 = row.max_x;
+        for (int16_t x = x0; x <= x1; ++x) {
+#if defined(PBL_BW)
+            uint8_t bit = 1 << (x % 8);
+            if (whitePixel(color)) {
+                row.data[x / 8] |= bit;
+            } else {
+                row.data[x / 8] &= ~bit;
+            }
+#else
+            row.data[x] = color.argb;
+#endif
+        }
+    }
+}
+
+void graphics_fill_rect(GContext* ctx, GRect rect, uint16_t corner_radius, GCornerMask corner_mask) {
+    rect.origin.x += ctx->frame.origin.x;
+    rect.origin.y += ctx->frame.origin.y;
+    grect_clip(&rect, &ctx->frame);
+    fillScreenRect(rect, ctx->fill);
+}
+
+/* One pixel wide, whatever the stroke width. */
+void graphics_draw_line(GContext* ctx, GPoint p0, GPoint p1) {
+    int16_t dx = abs(p1.x - p0.x), sx = p0.x < p1.x ? 1 : -1;
+    int16_t dy = -abs(p1.y - p0.y), sy = p0.y < p1.y ? 1 : -1;
+    int16_t error = dx + dy;
+    for (;;) {
+        GRect pixel = GRect(ctx->frame.origin.x + p0.x, ctx->frame.origin.y + p0.y, 1, 1);
+        grect_clip(&pixel, &ctx->frame);
+        fillScreenRect(pixel, ctx->stroke);
+        if (p0.x == p1.x && p0.y == p1.y) {
+            break;
+        }
+        int16_t twice = 2 * error;
+        if (twice >= dy) {
+            error += dy;
+            p0.x += sx;
+        }
+        if (twice <= dx) {
+            error += dx;
+            p0.y += sy;
+        }
+    }
+}
+
+// --------------------------------------------------------------------------
+// Text
+// --------------------------------------------------------------------------
+
+/* System fonts are not in the SDK stub, so system font text is measured
+   roughly and not drawn. */
+struct HostFont {
+    int16_t em;
+};
+
+static struct HostFont systemFonts[] = { { 14 }, { 18 }, { 24 }, { 28 } };
+
+GFont fonts_get_system_font(const char* font_key) {
+    for (size_t k = 0; k < ARRAY_LENGTH(systemFonts); ++k) {
+        char em[8];
+        snprintf(em, sizeof(em), "_%d", systemFonts[k].em);
+        if (strstr(font_key, em)) {
+            return &systemFonts[k];
+        }
+    }
+    return &systemFonts[0];
+}
+
+GSize graphics_text_layout_get_content_size(const char* text, GFont font, GRect box,
+                                            GTextOverflowMode overflow, GTextAlignment alignment) {
+    return GSize(strlen(text) * font->em / 2, font->em);
+}
+
+void graphics_draw_text(GContext* ctx, const char* text, GFont font, GRect box,
+                        GTextOverflowMode overflow, GTextAlignment alignment, GTextAttributes* attributes) {
+}
+
+// --------------------------------------------------------------------------
+// Layers and windows
+// --------------------------------------------------------------------------
+
+#define LAYER_CHILDREN_MAX 8
+
+struct Layer {
+    GRect frame;
+    LayerUpdateProc update;
+    Layer* parent;
+    Layer* children[LAYER_CHILDREN_MAX];
+    int childCount;
+    int index;
+};
+
+struct Window {
+    Layer* root;
+    GColor background;
+    WindowHandlers handlers;
+};
+
+static Window* topWindow;
+static bool windowDirty;
+static int layerCount;
+
+Layer* layer_create(GRect frame) {
+    Layer* layer = calloc(1, sizeof(Layer));
+    layer->frame = frame;
+    layer->index = layerCount++;
+    return layer;
+}
+
+void layer_destroy(Layer* layer) {
+    free(layer);
+}
+
+void layer_set_update_proc(Layer* layer, LayerUpdateProc update_proc) {
+    layer->update = update_proc;
+}
+
+void layer_add_child(Layer* parent, Layer* child) {
+    if (parent->childCount < LAYER_CHILDREN_MAX) {
+        parent->children[parent->childCount++] = child;
+        child->parent = parent;
+    }
+}
+
+/* The firmware repaints the whole window when any layer is dirty. */
+void layer_mark_dirty(Layer* layer) {
+    windowDirty = true;
+}
+
+GRect layer_get_frame(const Layer* layer) { return layer->frame; }
+
+GRect layer_get_bounds(const Layer* layer) {
+    return GRect(0, 0, layer->frame.size.w, layer->frame.size.h);
+}
+
+static GRect screenFrame(const Layer* layer) {
+    GRect frame = layer->frame;
+    for (const Layer* parent = layer->parent; parent; parent = parent->parent) {
+        frame.origin.x += parent->frame.origin.x;
+        frame.origin.y += parent->frame.origin.y;
+    }
+    return frame;
+}
+
+GRect layer_get_unobstructed_bounds(const Layer* layer) {
+    GRect frame = screenFrame(layer);
+    GRect area = GRect(0, 0, PBL_DISPLAY_WIDTH, PBL_DISPLAY_HEIGHT - host_options.obstruction);
+    grect_clip(&area, &frame);
+    area.origin.x -= frame.origin.x;
+    area.origin.y -= frame.origin.y;
+    return area;
+}
+
+Window* window_create(void) {
+    Window* window = calloc(1, sizeof(Window));
+    window->root = layer_create(GRect(0, 0, PBL_DISPLAY_WIDTH, PBL_DISPLAY_HEIGHT));
+    window->background = GColorWhite;
+    return window;
+}
+
+void window_destroy(Window* window) {
+    if (window == topWindow) {
+        topWindow = NULL;
+    }
+    layer_destroy(window->root);
+    free(window);
+}
+
+void window_set_background_color(Window* window, GColor color) { window->background = color; }
+void window_set_window_handlers(Window* window, WindowHandlers handlers) { window->handlers = handlers; }
+Layer* window_get_root_layer(const Window* window) { return window->root; }
+
+void window_stack_push(Window* window, bool animated) {
+    topWindow = window;
+    if (window->handlers.load) window->handlers.load(window);
+    if (window->handlers.appear) window->handlers.appear(window);
+    windowDirty = true;
+}
+
+static void renderLayer(Layer* layer, bool timed) {
+    if (layer->update) {
+        context.frame = screenFrame(layer);
+        uint64_t start = timed ? nanoseconds() : 0;
+        layer->update(layer, &context);
+        if (timed && layer->index < HOST_LAYERS_MAX) {
+            host_stats.layer[layer->index] += nanoseconds() - start;
+            if (layer->index >= host_stats.layerCount) {
+                host_stats.layerCount = layer->index + 1;
+            }
+        }
+    }
+    for (int k = 0; k < layer->childCount; ++k) {
+        renderLayer(layer->children[k], timed);
+    }
+}
+
+static void renderWindow(bool timed) {
+    windowDirty = false;
+    if (!topWindow) {
+        return;
+    }
+    uint64_t start = nanoseconds();
+    fillScreenRect(GRect(0, 0, PBL_DISPLAY_WIDTH, PBL_DISPLAY_HEIGHT), topWindow->background);
+    renderLayer(topWindow->root, timed);
+    if (timed) {
+        uint64_t frame = nanoseconds() - start;
+        if (!host_stats.frames || frame < host_stats.min) host_stats.min = frame;
+        if (frame > host_stats.max) host_stats.max = frame;
+        host_stats.total += frame;
+        host_stats.frames += 1;
+    }
+}
+
+// --------------------------------------------------------------------------
+// Timers
+// --------------------------------------------------------------------------
+
+struct AppTimer {
+    uint64_t due;
+    uint32_t order;
+    AppTimerCallback callback;
+    void* data;
+    AppTimer* next;
+};
+
+static AppTimer* timers;
+static uint32_t timerOrder;
+
+static void insertTimer(AppTimer* timer) {
+    AppTimer** link = &timers;
+    while (*link && ((*link)->due < timer->due
+                     || ((*link)->due == timer->due && (*link)->order < timer->order))) {
+        link = &(*link)->next;
+    }
+    timer->next = *link;
+    *link = timer;
+}
+
+static bool removeTimer(AppTimer* timer) {
+    for (AppTimer** link = &timers; *link; link = &(*link)->next) {
+        if (*link == timer) {
+            *link = timer->next;
+            return true;
+        }
+    }
+    return false;
+}
+
+AppTimer* app_timer_register(uint32_t timeout_ms, AppTimerCallback callback, void* data) {
+    AppTimer* timer = calloc(1, sizeof(AppTimer));
+    timer->due = clockNow() + timeout_ms;
+    timer->order = timerOrder++;
+    timer->callback = callback;
+    timer->data = data;
+    insertTimer(timer);
+    return timer;
+}
+
+bool app_timer_reschedule(AppTimer* timer, uint32_t new_timeout_ms) {
+    if (!removeTimer(timer)) {
+        return false;
+    }
+    timer->due = clockNow() + new_timeout_ms;
+    timer->order = timerOrder++;
+    insertTimer(timer);
+    return true;
+}
+
+void app_timer_cancel(AppTimer* timer) {
+    if (removeTimer(timer)) {
+        free(timer);
+    }
+}
+
+/* Run the next timer, skipping the clock ahead to it if need be. */
+static bool fireTimer() {
+    AppTimer* timer = timers;
+    if (!timer) {
+        return false;
+    }
+    uint64_t now = clockNow();
+    if (timer->due > now) {
+        clockOffset += timer->due - now;
+    }
+    timers = timer->next;
+    AppTimerCallback callback = timer->callback;
+    void* data = timer->data;
+    free(timer);
+    callback(data);
+    return true;
+}
+
+// --------------------------------------------------------------------------
+// Animation
+// --------------------------------------------------------------------------
+
+#define ANIMATION_FRAME_MS 33
+
+struct Animation {
+    AnimationImplementation implementation;
+    AnimationHandlers handlers;
+    void* context;
+    AnimationCurve curve;
+    uint32_t duration;
+    uint64_t start;
+    AppTimer* timer;
+};
+
+Animation* animation_create(void) {
+    Animation* animation = calloc(1, sizeof(Animation));
+    animation->duration = 250;
+    animation->curve = AnimationCurveEaseInOut;
+    return animation;
+}
+
+bool animation_destroy(Animation* animation) {
+    if (!animation) {
+        return false;
+    }
+    if (animation->timer) {
+        app_timer_cancel(animation->timer);
+    }
+    free(animation);
+    return true;
+}
+
+bool animation_set_implementation(Animation* animation, const AnimationImplementation* implementation) {
+    animation->implementation = *implementation;
+    return true;
+}
+
+bool animation_set_duration(Animation* animation, uint32_t duration_ms) {
+    animation->duration = duration_ms;
+    return true;
+}
+
+bool animation_set_curve(Animation* animation, AnimationCurve curve) {
+    animation->curve = curve;
+    return true;
+}
+
+bool animation_set_handlers(Animation* animation, AnimationHandlers handlers, void* context) {
+    animation->handlers = handlers;
+    animation->context = context;
+    return true;
+}
+
+static AnimationProgress applyCurve(AnimationCurve curve, double t) {
+    switch (curve) {
+        case AnimationCurveEaseIn: t = t * t; break;
+        case AnimationCurveEaseOut: t = t * (2 - t); break;
+        case AnimationCurveEaseInOut: t = t < 0.5 ? 2 * t * t : -1 + (4 - 2 * t) * t; break;
+        default: break;
+    }
+    return (AnimationProgress)lround(t * ANIMATION_NORMALIZED_MAX);
+}
+
+static void stepAnimation(void* data) {
+    Animation* animation = data;
+    animation->timer = NULL;
+    uint64_t elapsed = clockNow() - animation->start;
+    bool finished = elapsed >= animation->duration;
+    double t = finished ? 1.0 : (double)elapsed / animation->duration;
+    if (animation->implementation.update) {
+        animation->implementation.update(animation, applyCurve(animation->curve, t));
+    }
+    if (!finished) {
+        animation->timer = app_timer_register(ANIMATION_FRAME_MS, stepAnimation, animation);
+        return;
+    }
+    /* The stopped handler may destroy the animation. */
+    AnimationTeardownImplementation teardown = animation->implementation.teardown;
+    if (teardown) teardown(animation);
+    if (animation->handlers.stopped) {
+        animation->handlers.stopped(animation, true, animation->context);
+    }
+}
+
+bool animation_schedule(Animation* animation) {
+    if (animation->implementation.setup) {
+        animation->implementation.setup(animation);
+    }
+    if (animation->handlers.started) {
+        animation->handlers.started(animation, animation->context);
+    }
+    animation->start = clockNow();
+    animation->timer = app_timer_register(ANIMATION_FRAME_MS, stepAnimation, animation);
+    return true;
+}
+
+bool animation_unschedule(Animation* animation) {
+    if (!animation->timer) {
+        return false;
+    }
+    app_timer_cancel(animation->timer);
+    animation->timer = NULL;
+    if (animation->handlers.stopped) {
+        animation->handlers.stopped(animation, false, animation->context);
+    }
+    return true;
+}
+
+bool animation_is_scheduled(Animation* animation) {
+    return animation && animation->timer;
+}
+
+// --------------------------------------------------------------------------
+// Event loop
+// --------------------------------------------------------------------------
+
+/* Paint and run timers until the face goes idle, then time full redraws.
+   The runner's cap stops a face that never settles. */
+#define EVENT_LOOP_CAP 100000
+
+void app_event_loop(void) {
+    for (int k = 0; k < EVENT_LOOP_CAP; ++k) {
+        if (windowDirty) {
+            renderWindow(false);
+        } else if (!fireTimer()) {
+            break;
+        }
+    }
+    for (uint32_t k = 0; k < host_options.frames; ++k) {
+        renderWindow(true);
+    }
+}
+
+// --------------------------------------------------------------------------
+// Services
+// --------------------------------------------------------------------------
+
+void tick_timer_service_subscribe(TimeUnits tick_units, TickHandler handler) {}
+void tick_timer_service_unsubscribe(void) {}
+
+BatteryChargeState battery_state_service_peek(void) {
+    return (BatteryChargeState) { .charge_percent = 80 };
+}
+
+void battery_state_service_subscribe(BatteryStateHandler handler) {}
+void battery_state_service_unsubscribe(void) {}
+
+bool bluetooth_connection_service_peek(void) { return true; }
+void bluetooth_connection_service_subscribe(BluetoothConnectionHandler handler) {}
+void bluetooth_connection_service_unsubscribe(void) {}
+
+void accel_tap_service_subscribe(AccelTapHandler handler) {}
+void accel_tap_service_unsubscribe(void) {}
+
+void app_focus_service_subscribe_handlers(AppFocusHandlers handlers) {}
+void app_focus_service_unsubscribe(void) {}
+
+void unobstructed_area_service_subscribe(UnobstructedAreaHandlers handlers, void* context) {}
+void unobstructed_area_service_unsubscribe(void) {}
+
+// --------------------------------------------------------------------------
+// Messages
+// --------------------------------------------------------------------------
+
+uint32_t dict_calc_buffer_size(const uint8_t tuple_count, ...) {
+    uint32_t size = 1;
+    va_list args;
+    va_start(args, tuple_count);
+    for (uint8_t k = 0; k < tuple_count; ++k) {
+        size += sizeof(Tuple) + va_arg(args, uint32_t);
+    }
+    va_end(args);
+    return size;
+}
+
+uint32_t dict_size(DictionaryIterator* iter) { return 0; }
+Tuple* dict_find(const DictionaryIterator* iter, const uint32_t key) { return NULL; }
+
+DictionaryResult dict_write_data(DictionaryIterator* iter, const uint32_t key, const uint8_t* data, const uint16_t size) {
+    return DICT_OK;
+}
+
+AppMessageResult app_message_open(const uint32_t size_inbound, const uint32_t size_outbound) {
+    return APP_MSG_OK;
+}
+
+void app_message_register_inbox_received(AppMessageInboxReceived received_callback) {}
+
+AppMessageResult app_message_outbox_begin(DictionaryIterator** iterator) {
+    return APP_MSG_NOT_CONNECTED;
+}
+
+AppMessageResult app_message_outbox_send(void) {
+    return APP_MSG_NOT_CONNECTED;
+}
+
+// --------------------------------------------------------------------------
+// Storage
+// --------------------------------------------------------------------------
+
+#define PERSIST_KEYS_MAX 64
+
+static struct {
+    bool used;
+    uint32_t key;
+    size_t size;
+    uint8_t data[PERSIST_DATA_MAX_LENGTH];
+} persisted[PERSIST_KEYS_MAX];
+
+static int persistFind(uint32_t key, bool create) {
+    int empty = -1;
+    for (int k = 0; k < PERSIST_KEYS_MAX; ++k) {
+        if (persisted[k].used && persisted[k].key == key) return k;
+        if (!persisted[k].used && empty < 0) empty = k;
+    }
+    if (create && empty >= 0) {
+        persisted[empty].used = true;
+        persisted[empty].key = key;
+        return empty;
+    }
+    return -1;
+}
+
+bool persist_exists(const uint32_t key) { return persistFind(key, false) >= 0; }
+
+int persist_get_size(const uint32_t key) {
+    int k = persistFind(key, false);
+    return k < 0 ? -1 : (int)persisted[k].size;
+}
+
+int persist_read_data(const uint32_t key, void* buffer, const size_t buffer_size) {
+    int k = persistFind(key, false);
+    if (k < 0) {
+        return -1;
+    }
+    size_t size = persisted[k].size < buffer_size ? persisted[k].size : buffer_size;
+    memcpy(buffer, persisted[k].data, size);
+    return (int)size;
+}
+
+int persist_write_data(const uint32_t key, const void* data, const size_t size) {
+    int k = persistFind(key, true);
+    if (k < 0) {
+        return -1;
+    }
+    persisted[k].size = size < PERSIST_DATA_MAX_LENGTH ? size : PERSIST_DATA_MAX_LENGTH;
+    memcpy(persisted[k].data, data, persisted[k].size);
+    return (int)persisted[k].size;
+}
+
+bool persist_read_bool(const uint32_t key) { return persist_read_int(key) != 0; }
+
+int32_t persist_read_int(const uint32_t key) {
+    int32_t value = 0;
+    persist_read_data(key, &value, sizeof(value));
+    return value;
+}
+
+int persist_write_bool(const uint32_t key, const bool value) {
+    return persist_write_int(key, value);
+}
+
+int persist_write_int(const uint32_t key, const int32_t value) {
+    return persist_write_data(key, &value, sizeof(value));
+}
+
+int persist_delete(const uint32_t key) {
+    int k = persistFind(key, false);
+    if (k >= 0) persisted[k].used = false;
+    return 0;
+}
+
+// --------------------------------------------------------------------------
+// Resources
+// --------------------------------------------------------------------------
+
+#if defined(PBL_PLATFORM_APLITE)
+#define PLATFORM_NAME "aplite"
+#elif defined(PBL_PLATFORM_BASALT)
+#define PLATFORM_NAME "basalt"
+#elif defined(PBL_PLATFORM_CHALK)
+#define PLATFORM_NAME "chalk"
+#elif defined(PBL_PLATFORM_DIORITE)
+#define PLATFORM_NAME "diorite"
+#else
+#define PLATFORM_NAME "emery"
+#endif
+
+struct HostResource {
+    const char* file;
+    uint8_t* data;
+    size_t size;
+};
+
+static struct HostResource resources[] = {
+    [RESOURCE_ID_DIN_CONDENSED_FFONT] = { "din-condensed.ffont" },
+    [RESOURCE_ID_DIGIT_ATLAS] = { "digits~" PLATFORM_NAME ".atlas" },
+};
+
+ResHandle resource_get_handle(uint32_t resource_id) {
+    if (resource_id >= ARRAY_LENGTH(resources) || !resources[resource_id].file) {
+        return NULL;
+    }
+    struct HostResource* resource = &resources[resource_id];
+    if (!resource->data) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", host_options.resources, resource->file);
+        FILE* file = fopen(path, "rb");
+        if (!file) {
+            fprintf(stderr, "cannot open resource %s\n", path);
+            exit(1);
+        }
+        fseek(file, 0, SEEK_END);
+        resource->size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+        resource->data = malloc(resource->size);
+        if (fread(resource->data, 1, resource->size, file) != resource->size) {
+            fprintf(stderr, "cannot read resource %s\n", path);
+            exit(1);
+        }
+        fclose(file);
+    }
+    return resource;
+}
+
+size_t resource_size(ResHandle handle) {
+    return handle ? handle->size : 0;
+}
+
+size_t resource_load_byte_range(ResHandle handle, uint32_t start_offset, uint8_t* buffer, size_t num_bytes) {
+    if (!handle || start_offset >= handle->size) {
+        return 0;
+    }
+    if (num_bytes > handle->size - start_offset) {
+        num_bytes = handle->size - start_offset;
+    }
+    memcpy(buffer, handle->data + start_offset, num_bytes);
+    return num_bytes;
+}
+
+size_t resource_load(ResHandle handle, uint8_t* buffer, size_t max_length) {
+    return resource_load_byte_range(handle, 0, buffer, max_length);
+}
+
+// --------------------------------------------------------------------------
+// System
+// --------------------------------------------------------------------------
+
+/* The face budgets its caches against the app heap of the platform. */
+size_t heap_bytes_free(void) {
+    return PBL_IF_COLOR_ELSE(48, 16) * 1024;
+}
+
+size_t heap_bytes_used(void) {
+    return 8 * 1024;
+}
+
+void app_log(uint8_t log_level, const char* src_filename, int src_line_number, const char* fmt, ...) {
+    if (host_options.quiet) {
+        return;
+    }
+    const char* name = strrchr(src_filename, '/');
+    fprintf(stderr, "[%s:%d] ", name ? name + 1 : src_filename, src_line_number);
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
@@ -0,0 +1,533 @@
+#pragma once
+
+/* A stub of the Pebble SDK, just big enough to build the face, pebble-fctx
+   and pebble-utf8 on a desktop machine.  Drawing goes to an in-memory
+   framebuffer in the format of the target platform, which the Makefile
+   picks with -DPBL_PLATFORM_<NAME>.  Services never fire; the runner in
+   render.c drives the face instead.  See pebble.c. */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* The face's main() runs inside the host runner. */
+#ifndef HOST_RUNNER
+#define main face_main
+#endif
+
+// --------------------------------------------------------------------------
+// Platform
+// --------------------------------------------------------------------------
+
+#if defined(PBL_PLATFORM_APLITE) || defined(PBL_PLATFORM_DIORITE)
+#define PBL_BW
+#define PBL_RECT
+#define PBL_DISPLAY_WIDTH 144
+#define PBL_DISPLAY_HEIGHT 168
+#elif defined(PBL_PLATFORM_BASALT)
+#define PBL_COLOR
+#define PBL_RECT
+#define PBL_DISPLAY_WIDTH 144
+#define PBL_DISPLAY_HEIGHT 168
+#elif defined(PBL_PLATFORM_CHALK)
+#define PBL_COLOR
+#define PBL_ROUND
+#define PBL_DISPLAY_WIDTH 180
+#define PBL_DISPLAY_HEIGHT 180
+#elif defined(PBL_PLATFORM_EMERY)
+#define PBL_COLOR
+#define PBL_RECT
+#define PBL_DISPLAY_WIDTH 200
+#define PBL_DISPLAY_HEIGHT 228
+#else
+#error "define one of PBL_PLATFORM_APLITE, BASALT, CHALK, DIORITE or EMERY"
+#endif
+
+#ifdef PBL_COLOR
+#define PBL_IF_COLOR_ELSE(a, b) (a)
+#define PBL_IF_BW_ELSE(a, b) (b)
+#else
+#define PBL_IF_COLOR_ELSE(a, b) (b)
+#define PBL_IF_BW_ELSE(a, b) (a)
+#endif
+
+#ifdef PBL_ROUND
+#define PBL_IF_ROUND_ELSE(a, b) (a)
+#define PBL_IF_RECT_ELSE(a, b) (b)
+#else
+#define PBL_IF_ROUND_ELSE(a, b) (b)
+#define PBL_IF_RECT_ELSE(a, b) (a)
+#endif
+
+#define PBL_API_EXISTS(api) 1
+
+#define ARRAY_LENGTH(array) (sizeof(array) / sizeof((array)[0]))
+
+// --------------------------------------------------------------------------
+// Math
+// --------------------------------------------------------------------------
+
+#define TRIG_MAX_RATIO 0xffff
+#define TRIG_MAX_ANGLE 0x10000
+#define DEG_TO_TRIGANGLE(angle) (((angle) * TRIG_MAX_ANGLE) / 360)
+#define TRIGANGLE_TO_DEG(angle) (((angle) * 360) / TRIG_MAX_ANGLE)
+
+int32_t sin_lookup(int32_t angle);
+int32_t cos_lookup(int32_t angle);
+int32_t atan2_lookup(int16_t y, int16_t x);
+
+// --------------------------------------------------------------------------
+// Graphics types
+// --------------------------------------------------------------------------
+
+typedef union GColor8 {
+    uint8_t argb;
+    struct {
+        uint8_t b:2;
+        uint8_t g:2;
+        uint8_t r:2;
+        uint8_t a:2;
+    };
+} GColor8;
+
+typedef GColor8 GColor;
+
+#define GColorClearARGB8 ((uint8_t)0x00)
+#define GColorBlackARGB8 ((uint8_t)0xc0)
+#define GColorDarkGrayARGB8 ((uint8_t)0xd5)
+#define GColorLightGrayARGB8 ((uint8_t)0xea)
+#define GColorWhiteARGB8 ((uint8_t)0xff)
+#define GColorPictonBlueARGB8 ((uint8_t)0xd7)
+#define GColorIcterineARGB8 ((uint8_t)0xfe)
+
+#define GColorClear ((GColor8) { .argb = GColorClearARGB8 })
+#define GColorBlack ((GColor8) { .argb = GColorBlackARGB8 })
+#define GColorDarkGray ((GColor8) { .argb = GColorDarkGrayARGB8 })
+#define GColorLightGray ((GColor8) { .argb = GColorLightGrayARGB8 })
+#define GColorWhite ((GColor8) { .argb = GColorWhiteARGB8 })
+
+#define GColorFromRGBA(red, green, blue, alpha) ((GColor8) { \
+    .a = (uint8_t)(alpha) >> 6, .r = (uint8_t)(red) >> 6, \
+    .g = (uint8_t)(green) >> 6, .b = (uint8_t)(blue) >> 6 })
+#define GColorFromRGB(red, green, blue) GColorFromRGBA(red, green, blue, 255)
+
+bool gcolor_equal(GColor8 a, GColor8 b);
+
+typedef struct GPoint {
+    int16_t x;
+    int16_t y;
+} GPoint;
+
+#define GPoint(x, y) ((GPoint) { (x), (y) })
+#define GPointZero GPoint(0, 0)
+
+typedef struct GSize {
+    int16_t w;
+    int16_t h;
+} GSize;
+
+#define GSize(w, h) ((GSize) { (w), (h) })
+#define GSizeZero GSize(0, 0)
+
+typedef struct GRect {
+    GPoint origin;
+    GSize size;
+} GRect;
+
+#define GRect(x, y, w, h) ((GRect) { { (x), (y) }, { (w), (h) } })
+#define GRectZero GRect(0, 0, 0, 0)
+
+bool gpoint_equal(const GPoint* a, const GPoint* b);
+bool gsize_equal(const GSize* a, const GSize* b);
+bool grect_equal(const GRect* a, const GRect* b);
+bool grect_is_empty(const GRect* rect);
+void grect_standardize(GRect* rect);
+void grect_clip(GRect* rect_to_clip, const GRect* rect_clipper);
+bool grect_contains_point(const GRect* rect, const GPoint* point);
+GPoint grect_center_point(const GRect* rect);
+GRect grect_inset(GRect rect, int16_t inset);
+
+typedef enum {
+    GBitmapFormat1Bit,
+    GBitmapFormat8Bit,
+    GBitmapFormat1BitPalette,
+    GBitmapFormat2BitPalette,
+    GBitmapFormat4BitPalette,
+    GBitmapFormat8BitCircular,
+} GBitmapFormat;
+
+typedef struct GBitmap GBitmap;
+
+typedef struct {
+    uint8_t* data;
+    int16_t min_x;
+    int16_t max_x;
+} GBitmapDataRowInfo;
+
+GBitmap* gbitmap_create_blank(GSize size, GBitmapFormat format);
+void gbitmap_destroy(GBitmap* bitmap);
+GRect gbitmap_get_bounds(const GBitmap* bitmap);
+GBitmapFormat gbitmap_get_format(const GBitmap* bitmap);
+uint8_t* gbitmap_get_data(const GBitmap* bitmap);
+uint16_t gbitmap_get_bytes_per_row(const GBitmap* bitmap);
+GBitmapDataRowInfo gbitmap_get_data_row_info(const GBitmap* bitmap, uint16_t y);
+
+// --------------------------------------------------------------------------
+// Graphics context
+// --------------------------------------------------------------------------
+
+typedef struct GContext GContext;
+
+typedef enum {
+    GCompOpAssign,
+    GCompOpAssignInverted,
+    GCompOpOr,
+    GCompOpAnd,
+    GCompOpClear,
+    GCompOpSet,
+} GCompOp;
+
+typedef enum {
+    GCornerNone = 0,
+    GCornersAll = 0xf,
+} GCornerMask;
+
+GBitmap* graphics_capture_frame_buffer(GContext* ctx);
+GBitmap* graphics_capture_frame_buffer_format(GContext* ctx, GBitmapFormat format);
+bool graphics_release_frame_buffer(GContext* ctx, GBitmap* buffer);
+bool graphics_frame_buffer_is_captured(GContext* ctx);
+
+void graphics_context_set_fill_color(GContext* ctx, GColor color);
+void graphics_context_set_stroke_color(GContext* ctx, GColor color);
+void graphics_context_set_text_color(GContext* ctx, GColor color);
+void graphics_context_set_antialiased(GContext* ctx, bool enable);
+void graphics_context_set_compositing_mode(GContext* ctx, GCompOp mode);
+void graphics_fill_rect(GContext* ctx, GRect rect, uint16_t corner_radius, GCornerMask corner_mask);
+void graphics_draw_line(GContext* ctx, GPoint p0, GPoint p1);
+
+// --------------------------------------------------------------------------
+// Text
+// --------------------------------------------------------------------------
+
+typedef struct HostFont* GFont;
+
+typedef enum {
+    GTextAlignmentLeft,
+    GTextAlignmentCenter,
+    GTextAlignmentRight,
+} GTextAlignment;
+
+typedef enum {
+    GTextOverflowModeWordWrap,
+    GTextOverflowModeTrailingEllipsis,
+    GTextOverflowModeFill,
+} GTextOverflowMode;
+
+typedef struct GTextAttributes GTextAttributes;
+
+#define FONT_KEY_GOTHIC_14 "RESOURCE_ID_GOTHIC_14"
+#define FONT_KEY_GOTHIC_14_BOLD "RESOURCE_ID_GOTHIC_14_BOLD"
+#define FONT_KEY_GOTHIC_18 "RESOURCE_ID_GOTHIC_18"
+#define FONT_KEY_GOTHIC_18_BOLD "RESOURCE_ID_GOTHIC_18_BOLD"
+#define FONT_KEY_GOTHIC_24 "RESOURCE_ID_GOTHIC_24"
+#define FONT_KEY_GOTHIC_24_BOLD "RESOURCE_ID_GOTHIC_24_BOLD"
+#define FONT_KEY_GOTHIC_28 "RESOURCE_ID_GOTHIC_28"
+#define FONT_KEY_GOTHIC_28_BOLD "RESOURCE_ID_GOTHIC_28_BOLD"
+
+GFont fonts_get_system_font(const char* font_key);
+GSize graphics_text_layout_get_content_size(const char* text, GFont font, GRect box,
+                                            GTextOverflowMode overflow, GTextAlignment alignment);
+void graphics_draw_text(GContext* ctx, const char* text, GFont font, GRect box,
+                        GTextOverflowMode overflow, GTextAlignment alignment, GTextAttributes* attributes);
+
+// --------------------------------------------------------------------------
+// Layers and windows
+// --------------------------------------------------------------------------
+
+typedef struct Layer Layer;
+typedef struct Window Window;
+typedef void (*LayerUpdateProc)(Layer* layer, GContext* ctx);
+
+Layer* layer_create(GRect frame);
+void layer_destroy(Layer* layer);
+void layer_set_update_proc(Layer* layer, LayerUpdateProc update_proc);
+void layer_add_child(Layer* parent, Layer* child);
+void layer_mark_dirty(Layer* layer);
+GRect layer_get_frame(const Layer* layer);
+GRect layer_get_bounds(const Layer* layer);
+GRect layer_get_unobstructed_bounds(const Layer* layer);
+
+typedef void (*WindowHandler)(Window* window);
+
+typedef struct {
+    WindowHandler load;
+    WindowHandler appear;
+    WindowHandler disappear;
+    WindowHandler unload;
+} WindowHandlers;
+
+Window* window_create(void);
+void window_destroy(Window* window);
+void window_set_background_color(Window* window, GColor color);
+void window_set_window_handlers(Window* window, WindowHandlers handlers);
+void window_stack_push(Window* window, bool animated);
+Layer* window_get_root_layer(const Window* window);
+
+// --------------------------------------------------------------------------
+// Animation and timers
+// --------------------------------------------------------------------------
+
+typedef struct Animation Animation;
+typedef uint32_t AnimationProgress;
+
+#define ANIMATION_NORMALIZED_MIN 0
+#define ANIMATION_NORMALIZED_MAX 65535
+
+typedef void (*AnimationSetupImplementation)(Animation* animation);
+typedef void (*AnimationUpdateImplementation)(Animation* animation, const AnimationProgress progress);
+typedef void (*AnimationTeardownImplementation)(Animation* animation);
+
+typedef struct {
+    AnimationSetupImplementation setup;
+    AnimationUpdateImplementation update;
+    AnimationTeardownImplementation teardown;
+} AnimationImplementation;
+
+typedef void (*AnimationStartedHandler)(Animation* animation, void* context);
+typedef void (*AnimationStoppedHandler)(Animation* animation, bool finished, void* context);
+
+typedef struct {
+    AnimationStartedHandler started;
+    AnimationStoppedHandler stopped;
+} AnimationHandlers;
+
+typedef enum {
+    AnimationCurveLinear,
+    AnimationCurveEaseIn,
+    AnimationCurveEaseOut,
+    AnimationCurveEaseInOut,
+} AnimationCurve;
+
+Animation* animation_create(void);
+bool animation_destroy(Animation* animation);
+bool animation_set_implementation(Animation* animation, const AnimationImplementation* implementation);
+bool animation_set_duration(Animation* animation, uint32_t duration_ms);
+bool animation_set_curve(Animation* animation, AnimationCurve curve);
+bool animation_set_handlers(Animation* animation, AnimationHandlers handlers, void* context);
+bool animation_schedule(Animation* animation);
+bool animation_unschedule(Animation* animation);
+bool animation_is_scheduled(Animation* animation);
+
+typedef struct AppTimer AppTimer;
+typedef void (*AppTimerCallback)(void* data);
+
+AppTimer* app_timer_register(uint32_t timeout_ms, AppTimerCallback callback, void* data);
+bool app_timer_reschedule(AppTimer* timer, uint32_t new_timeout_ms);
+void app_timer_cancel(AppTimer* timer);
+
+void app_event_loop(void);
+
+// --------------------------------------------------------------------------
+// Services
+// --------------------------------------------------------------------------
+
+typedef enum {
+    SECOND_UNIT = 1 << 0,
+    MINUTE_UNIT = 1 << 1,
+    HOUR_UNIT = 1 << 2,
+    DAY_UNIT = 1 << 3,
+    MONTH_UNIT = 1 << 4,
+    YEAR_UNIT = 1 << 5,
+} TimeUnits;
+
+typedef void (*TickHandler)(struct tm* tick_time, TimeUnits units_changed);
+void tick_timer_service_subscribe(TimeUnits tick_units, TickHandler handler);
+void tick_timer_service_unsubscribe(void);
+
+typedef struct {
+    uint8_t charge_percent;
+    bool is_charging;
+    bool is_plugged;
+} BatteryChargeState;
+
+typedef void (*BatteryStateHandler)(BatteryChargeState charge);
+BatteryChargeState battery_state_service_peek(void);
+void battery_state_service_subscribe(BatteryStateHandler handler);
+void battery_state_service_unsubscribe(void);
+
+typedef void (*BluetoothConnectionHandler)(bool connected);
+bool bluetooth_connection_service_peek(void);
+void bluetooth_connection_service_subscribe(BluetoothConnectionHandler handler);
+void bluetooth_connection_service_unsubscribe(void);
+
+typedef enum {
+    ACCEL_AXIS_X,
+    ACCEL_AXIS_Y,
+    ACCEL_AXIS_Z,
+} AccelAxisType;
+
+typedef void (*AccelTapHandler)(AccelAxisType axis, int32_t direction);
+void accel_tap_service_subscribe(AccelTapHandler handler);
+void accel_tap_service_unsubscribe(void);
+
+typedef void (*AppFocusHandler)(bool in_focus);
+
+typedef struct {
+    AppFocusHandler will_focus;
+    AppFocusHandler did_focus;
+} AppFocusHandlers;
+
+void app_focus_service_subscribe_handlers(AppFocusHandlers handlers);
+void app_focus_service_unsubscribe(void);
+
+typedef void (*UnobstructedAreaWillChangeHandler)(GRect final_unobstructed_screen_area, void* context);
+typedef void (*UnobstructedAreaChangeHandler)(AnimationProgress progress, void* context);
+typedef void (*UnobstructedAreaDidChangeHandler)(void* context);
+
+typedef struct {
+    UnobstructedAreaWillChangeHandler will_change;
+    UnobstructedAreaChangeHandler change;
+    UnobstructedAreaDidChangeHandler did_change;
+} UnobstructedAreaHandlers;
+
+void unobstructed_area_service_subscribe(UnobstructedAreaHandlers handlers, void* context);
+void unobstructed_area_service_unsubscribe(void);
+
+// --------------------------------------------------------------------------
+// Messages
+// --------------------------------------------------------------------------
+
+typedef enum {
+    TUPLE_BYTE_ARRAY = 0,
+    TUPLE_CSTRING = 1,
+    TUPLE_UINT = 2,
+    TUPLE_INT = 3,
+} TupleType;
+
+typedef struct __attribute__((packed)) {
+    uint32_t key;
+    TupleType type:8;
+    uint16_t length;
+    union {
+        uint8_t data[0];
+        char cstring[0];
+        uint8_t uint8;
+        uint16_t uint16;
+        uint32_t uint32;
+        int8_t int8;
+        int16_t int16;
+        int32_t int32;
+    } value[];
+} Tuple;
+
+typedef struct DictionaryIterator DictionaryIterator;
+
+typedef enum {
+    DICT_OK = 0,
+    DICT_NOT_ENOUGH_STORAGE = 1 << 1,
+    DICT_INVALID_ARGS = 1 << 2,
+} DictionaryResult;
+
+typedef enum {
+    APP_MSG_OK = 0,
+    APP_MSG_NOT_CONNECTED = 1 << 3,
+} AppMessageResult;
+
+#define APP_MESSAGE_INBOX_SIZE_MINIMUM 124
+#define APP_MESSAGE_OUTBOX_SIZE_MINIMUM 636
+
+uint32_t dict_calc_buffer_size(const uint8_t tuple_count, ...);
+uint32_t dict_size(DictionaryIterator* iter);
+Tuple* dict_find(const DictionaryIterator* iter, const uint32_t key);
+DictionaryResult dict_write_data(DictionaryIterator* iter, const uint32_t key, const uint8_t* data, const uint16_t size);
+
+typedef void (*AppMessageInboxReceived)(DictionaryIterator* iterator, void* context);
+AppMessageResult app_message_open(const uint32_t size_inbound, const uint32_t size_outbound);
+void app_message_register_inbox_received(AppMessageInboxReceived received_callback);
+AppMessageResult app_message_outbox_begin(DictionaryIterator** iterator);
+AppMessageResult app_message_outbox_send(void);
+
+/* Generated from package.json, as the SDK does; see message-keys.py. */
+#include "message_keys.auto.h"
+
+// --------------------------------------------------------------------------
+// Storage, resources and system
+// --------------------------------------------------------------------------
+
+#define PERSIST_DATA_MAX_LENGTH 256
+
+bool persist_exists(const uint32_t key);
+int persist_get_size(const uint32_t key);
+bool persist_read_bool(const uint32_t key);
+int32_t persist_read_int(const uint32_t key);
+int persist_read_data(const uint32_t key, void* buffer, const size_t buffer_size);
+int persist_write_bool(const uint32_t key, const bool value);
+int persist_write_int(const uint32_t key, const int32_t value);
+int persist_write_data(const uint32_t key, const void* data, const size_t size);
+int persist_delete(const uint32_t key);
+
+/* Generated from package.json by the SDK.  pebble.c maps each one to its
+   file in resources/. */
+#define RESOURCE_ID_DIN_CONDENSED_FFONT 1
+#define RESOURCE_ID_DIGIT_ATLAS 2
+
+typedef struct HostResource* ResHandle;
+
+ResHandle resource_get_handle(uint32_t resource_id);
+size_t resource_size(ResHandle handle);
+size_t resource_load(ResHandle handle, uint8_t* buffer, size_t max_length);
+size_t resource_load_byte_range(ResHandle handle, uint32_t start_offset, uint8_t* buffer, size_t num_bytes);
+
+uint16_t time_ms(time_t* t_utc, uint16_t* out_ms);
+bool clock_is_24h_style(void);
+bool clock_is_timezone_set(void);
+#define TIMEZONE_NAME_LENGTH 32
+void clock_get_timezone(char* timezone, const size_t buffer_size);
+
+size_t heap_bytes_free(void);
+size_t heap_bytes_used(void);
+
+typedef enum {
+    APP_LOG_LEVEL_ERROR = 1,
+    APP_LOG_LEVEL_WARNING = 50,
+    APP_LOG_LEVEL_INFO = 100,
+    APP_LOG_LEVEL_DEBUG = 200,
+    APP_LOG_LEVEL_DEBUG_VERBOSE = 255,
+} AppLogLevel;
+
+void app_log(uint8_t log_level, const char* src_filename, int src_line_number, const char* fmt, ...);
+
+#define APP_LOG(level, fmt, args...) app_log(level, __FILE__, __LINE__, fmt, ## args)
+
+// --------------------------------------------------------------------------
+// Host runner
+// --------------------------------------------------------------------------
+
+/* What the runner in render.c sets before it calls the face's main(). */
+typedef struct {
+    const char* resources;      // path to resources/data
+    int16_t obstruction;        // rows hidden at the bottom, as by Quick View
+    uint32_t frames;            // full redraws to time after the face settles
+    bool quiet;                 // drop the face's log output
+} HostOptions;
+
+/* Per-layer cost of the redraws the runner timed, in nanoseconds. */
+#define HOST_LAYERS_MAX 8
+
+typedef struct {
+    uint32_t frames;
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+    uint64_t layer[HOST_LAYERS_MAX];
+    int layerCount;
+} HostStats;
+
+extern HostOptions host_options;
+extern HostStats host_stats;
+
+GBitmap* host_frame_buffer(void);
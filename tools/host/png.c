@@ -0,0 +1,133 @@
+#include "png.h"
+
+/* A minimal PNG writer: 8-bit RGB, no filtering, and stored (uncompressed)
+   deflate blocks, so that it needs nothing beyond the C library. */
+
+static uint32_t crcTable[256];
+
+static void makeCrcTable() {
+    for (uint32_t n = 0; n < 256; ++n) {
+        uint32_t c = n;
+        for (int k = 0; k < 8; ++k) {
+            c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+        }
+        crcTable[n] = c;
+    }
+}
+
+static uint32_t crc32(uint32_t crc, const uint8_t* data, size_t length) {
+    crc = ~crc;
+    for (size_t k = 0; k < length; ++k) {
+        crc = crcTable[(crc ^ data[k]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static void put32(uint8_t* p, uint32_t value) {
+    p[0] = value >> 24;
+    p[1] = value >> 16;
+    p[2] = value >> 8;
+    p[3] = value;
+}
+
+static bool writeChunk(FILE* file, const char* type, const uint8_t* data, uint32_t length) {
+    uint8_t head[8];
+    put32(head, length);
+    memcpy(head + 4, type, 4);
+    uint32_t crc = crc32(crc32(0, head + 4, 4), data, length);
+    uint8_t tail[4];
+    put32(tail, crc);
+    return fwrite(head, 1, 8, file) == 8
+        && fwrite(data, 1, length, file) == length
+        && fwrite(tail, 1, 4, file) == 4;
+}
+
+/* Expand one row of the framebuffer to RGB. */
+static void convertRow(GBitmap* fb, int16_t y, uint8_t* rgb) {
+    GRect bounds = gbitmap_get_bounds(fb);
+    GBitmapDataRowInfo row = gbitmap_get_data_row_info(fb, y);
+    for (int16_t x = 0; x < bounds.size.w; ++x) {
+        uint8_t* p = rgb + 3 * x;
+        if (x < row.min_x || x > row.max_x) {
+            p[0] = p[1] = p[2] = 0;
+            continue;
+        }
+#if defined(PBL_BW)
+        uint8_t v = (row.data[x / 8] >> (x % 8)) & 1 ? 0xff : 0;
+        p[0] = p[1] = p[2] = v;
+#else
+        GColor8 color = { .argb = row.data[x] };
+        p[0] = color.r * 85;
+        p[1] = color.g * 85;
+        p[2] = color.b * 85;
+#endif
+    }
+}
+
+bool png_write_frame_buffer(const char* path, GBitmap* fb) {
+    if (!crcTable[1]) {
+        makeCrcTable();
+    }
+
+    GRect bounds = gbitmap_get_bounds(fb);
+    uint32_t w = bounds.size.w;
+    uint32_t h = bounds.size.h;
+    uint32_t rowSize = 1 + 3 * w;
+    uint32_t rawSize = rowSize * h;
+
+    /* The zlib stream: header, stored blocks of up to 65535 bytes, and the
+       Adler-32 of the raw data. */
+    uint32_t blocks = (rawSize + 65534) / 65535;
+    uint32_t zSize = 2 + blocks * 5 + rawSize + 4;
+    uint8_t* raw = malloc(rawSize);
+    uint8_t* z = malloc(zSize);
+
+    for (uint32_t y = 0; y < h; ++y) {
+        raw[y * rowSize] = 0;
+        convertRow(fb, y, raw + y * rowSize + 1);
+    }
+
+    uint8_t* p = z;
+    *p++ = 0x78;
+    *p++ = 0x01;
+    for (uint32_t offset = 0; offset < rawSize; offset += 65535) {
+        uint32_t length = rawSize - offset < 65535 ? rawSize - offset : 65535;
+        *p++ = offset + length == rawSize ? 1 : 0;
+        *p++ = length;
+        *p++ = length >> 8;
+        *p++ = ~length;
+        *p++ = ~length >> 8;
+        memcpy(p, raw + offset, length);
+        p += length;
+    }
+    uint32_t a = 1, b = 0;
+    for (uint32_t k = 0; k < rawSize; ++k) {
+        a = (a + raw[k]) % 65521;
+        b = (b + a) % 65521;
+    }
+    put32(p, (b << 16) | a);
+
+    uint8_t header[13];
+    put32(header, w);
+    put32(header + 4, h);
+    header[8] = 8;      // bit depth
+    header[9] = 2;      // RGB
+    header[10] = 0;     // deflate
+    header[11] = 0;     // adaptive filtering
+    header[12] = 0;     // no interlace
+
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    bool ok = false;
+    FILE* file = fopen(path, "wb");
+    if (file) {
+        ok = fwrite(signature, 1, 8, file) == 8
+            && writeChunk(file, "IHDR", header, sizeof(header))
+            && writeChunk(file, "IDAT", z, zSize)
+            && writeChunk(file, "IEND", NULL, 0);
+        ok = (fclose(file) == 0) && ok;
+    }
+
+    free(raw);
+    free(z);
+    return ok;
+}
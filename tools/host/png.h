@@ -0,0 +1,7 @@
+#pragma once
+#include <pebble.h>
+
+/* Write the framebuffer to an RGB PNG file.  Pixels outside the visible
+   span of a round display come out black.  Returns false on an I/O
+   error. */
+bool png_write_frame_buffer(const char* path, GBitmap* fb);
@@ -0,0 +1,60 @@
+/*
+ * Run the face once on the host against the stub SDK, write the settled
+ * frame to a PNG, and time full redraws of it.
+ *
+ *   render [-r resources] [-o frame.png] [-n frames] [-p rows] [-q]
+ *
+ * -r  where to find the resource files, by default resources/data
+ * -o  write the settled frame to this PNG file
+ * -n  time this many full redraws after the face settles
+ * -p  hide this many rows at the bottom, like a Quick View peek
+ * -q  drop the face's log output
+ */
+
+#define HOST_RUNNER
+#include "pebble.h"
+#include "png.h"
+#include <unistd.h>
+
+int face_main(void);
+
+static const char* kLayerNames[] = { "window", "dial", "sun", "readout", "text" };
+
+static void usage(const char* name) {
+    fprintf(stderr, "usage: %s [-r resources] [-o frame.png] [-n frames] [-p rows] [-q]\n", name);
+    exit(2);
+}
+
+int main(int argc, char* argv[]) {
+    const char* output = NULL;
+    int option;
+    while ((option = getopt(argc, argv, "r:o:n:p:q")) != -1) {
+        switch (option) {
+            case 'r': host_options.resources = optarg; break;
+            case 'o': output = optarg; break;
+            case 'n': host_options.frames = strtoul(optarg, NULL, 10); break;
+            case 'p': host_options.obstruction = atoi(optarg); break;
+            case 'q': host_options.quiet = true; break;
+            default: usage(argv[0]);
+        }
+    }
+
+    face_main();
+
+    if (host_stats.frames) {
+        double frames = host_stats.frames;
+        printf("frame: %.3f ms (min %.3f, max %.3f) over %u frames\n",
+               host_stats.total / frames / 1e6, host_stats.min / 1e6,
+               host_stats.max / 1e6, host_stats.frames);
+        for (int k = 1; k < host_stats.layerCount; ++k) {
+            const char* name = k < (int)ARRAY_LENGTH(kLayerNames) ? kLayerNames[k] : "layer";
+            printf("  %-8s %.3f ms\n", name, host_stats.layer[k] / frames / 1e6);
+        }
+    }
+
+    if (output && !png_write_frame_buffer(output, host_frame_buffer())) {
+        fprintf(stderr, "cannot write %s\n", output);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,20 @@
+/*
+ * Print the watch's sun events for each line of "year month day longitude
+ * latitude" on stdin, in degrees, as "rise set south status" in minutes.
+ * sunriset-check.js compares them with the phone's algorithm.
+ */
+
+#define HOST_RUNNER
+#include "pebble.h"
+#include "sunriset.h"
+
+int main(void) {
+    int year, month, day;
+    double longitude, latitude;
+    while (scanf("%d %d %d %lf %lf", &year, &month, &day, &longitude, &latitude) == 5) {
+        SunEvents events;
+        sun_rise_set(year, month, day, (int32_t)(longitude * 0x10000), (int32_t)(latitude * 0x10000), &events);
+        printf("%d %d %d %d\n", events.rise, events.set, events.south, events.status);
+    }
+    return 0;
+}
@@ -0,0 +1,118 @@
+/*
+ * Compare the watch's fixed point sun events (src/c/sunriset.c, built on
+ * the host as sunriset-check) with the phone's algorithm in
+ * src/pkjs/sunriset.js over a grid of dates and places, and report the
+ * largest differences by band of latitude.
+ *
+ *   node sunriset-check.js path/to/sunriset-check
+ *
+ * The grid is three years, two days a month, latitudes from -90 to 90 in
+ * 7.5 degree steps and six longitudes.  The JS copy computes the day
+ * count in floating point, which shifts it by up to a day, so it is
+ * compared here with the integer day count of the original SUNRISET.C,
+ * which the watch uses.
+ */
+
+var fs = require('fs');
+var path = require('path');
+var childProcess = require('child_process');
+
+/* Largest difference allowed in rise, set and south, in minutes, below
+   and above 60 degrees of latitude, and the number of status mismatches
+   allowed at the polar day and night boundaries. */
+var TOLERANCE_MID = 2;
+var TOLERANCE_POLAR = 4;
+var POLAR_LATITUDE = 60;
+var STATUS_MISMATCHES = 4;
+
+function loadSunriset() {
+    var file = path.join(__dirname, '..', '..', 'src', 'pkjs', 'sunriset.js');
+    var source = fs.readFileSync(file, 'utf8');
+    var floatDays = 'return 367*y - ((7*(y+((m+9)/12)))/4) + ((275*m)/9) +d-730530;';
+    var intDays = 'return 367*y - Math.floor((7*(y+Math.floor((m+9)/12)))/4) + Math.floor((275*m)/9) +d-730530;';
+    if (source.indexOf(floatDays) < 0) {
+        throw new Error('day count not found in ' + file);
+    }
+    var module = { exports: {} };
+    new Function('module', 'require', source.replace(floatDays, intDays))(module, require);
+    return module.exports;
+}
+
+function grid() {
+    var points = [];
+    [2017, 2026, 2040].forEach(function (year) {
+        for (var month = 1; month <= 12; ++month) {
+            [1, 15].forEach(function (day) {
+                for (var lat = -90; lat <= 90; lat += 7.5) {
+                    [-170, -74, -3.7, 0, 13.4, 139.7].forEach(function (lon) {
+                        points.push({ year: year, month: month, day: day, lon: lon, lat: lat });
+                    });
+                }
+            });
+        }
+    });
+    return points;
+}
+
+function main(argv) {
+    if (argv.length !== 1) {
+        console.error('usage: node sunriset-check.js path/to/sunriset-check');
+        return 2;
+    }
+
+    var sunriset = loadSunriset();
+    var points = grid();
+    var input = points.map(function (p) {
+        return [p.year, p.month, p.day, p.lon, p.lat].join(' ');
+    }).join('\n') + '\n';
+    var output = childProcess.execFileSync(argv[0], { input: input }).toString().trim().split('\n');
+    if (output.length !== points.length) {
+        console.error('expected ' + points.length + ' results, got ' + output.length);
+        return 1;
+    }
+
+    var bands = {};
+    var statusMismatches = 0;
+    var failed = false;
+    points.forEach(function (p, k) {
+        var watch = output[k].split(' ').map(Number);
+        var sun = sunriset.sun_rise_set(new Date(Date.UTC(p.year, p.month - 1, p.day, 12)), p.lon, p.lat);
+        if (watch[3] !== sun.status) {
+            ++statusMismatches;
+            return;
+        }
+        var band = Math.abs(p.lat) < POLAR_LATITUDE ? 'below ' + POLAR_LATITUDE : 'polar';
+        var limit = Math.abs(p.lat) < POLAR_LATITUDE ? TOLERANCE_MID : TOLERANCE_POLAR;
+        var stats = bands[band] || (bands[band] = { points: 0, rise: 0, set: 0, south: 0 });
+        ++stats.points;
+        var diff = {
+            south: Math.abs(watch[2] - Math.round(sun.south * 60))
+        };
+        /* Rise and set mean nothing when the sun stays up or down. */
+        if (sun.status === 0) {
+            diff.rise = Math.abs(watch[0] - Math.round(sun.rise * 60));
+            diff.set = Math.abs(watch[1] - Math.round(sun.set * 60));
+        }
+        Object.keys(diff).forEach(function (key) {
+            stats[key] = Math.max(stats[key], diff[key]);
+            if (diff[key] > limit) {
+                console.error(key + ' off by ' + diff[key] + ' min at ' +
+                              [p.year, p.month, p.day, p.lon, p.lat].join(' '));
+                failed = true;
+            }
+        });
+    });
+
+    Object.keys(bands).forEach(function (band) {
+        var stats = bands[band];
+        console.log('latitude ' + band + ': ' + stats.points + ' points, max difference rise ' +
+                    stats.rise + ', set ' + stats.set + ', south ' + stats.south + ' min');
+    });
+    console.log('status differs in ' + statusMismatches + ' of ' + points.length + ' points');
+    if (statusMismatches > STATUS_MISMATCHES) {
+        failed = true;
+    }
+    return failed ? 1 : 0;
+}
+
+process.exitCode = main(process.argv.slice(2));
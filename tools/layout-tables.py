@@ -0,0 +1,119 @@
+#!/usr/bin/env python
+#
+# Generate the full screen layout of the face for one target platform as
+# a header of constants, so that the watch does not compute it at startup
+# and keeps it in flash instead of RAM.  Run from wscript for each
+# platform.
+#
+# usage: layout-tables.py platform output.h
+#
+# The integer arithmetic mirrors computeLayout() in src/c/main.c, which
+# is still used at runtime for obstructed layouts.
+#
+
+from __future__ import division, print_function
+
+import math
+import sys
+
+FIXED_POINT_SCALE = 16
+TRIG_MAX_RATIO = 0x10000
+BATTERY_STEPS = 14
+HOURS = 24
+
+PLATFORMS = {
+    # name: (width, height, round)
+    'aplite': (144, 168, False),
+    'basalt': (144, 168, False),
+    'chalk': (180, 180, True),
+    'diorite': (144, 168, False),
+    'emery': (200, 228, False),
+}
+
+
+def isqrt(n):
+    """Integer square root, floor(sqrt(n))."""
+    if n <= 0:
+        return 0
+    x = 1 << ((n.bit_length() + 1) // 2)
+    while True:
+        y = (x + n // x) // 2
+        if y >= x:
+            return x
+        x = y
+
+
+def compute_layout(width, height, is_round):
+    design_radius = min(width, height) // 2 - (4 if is_round else 0)
+    sun_disc_radius = design_radius * 3 // 25
+    hour_cap_height = sun_disc_radius * 25 // 17
+    sun_disc_margin = sun_disc_radius * 1 // 3
+    sun_orbit_radius = design_radius - sun_disc_margin - sun_disc_radius
+    readout_disc_radius = sun_orbit_radius - sun_disc_radius - sun_disc_margin
+    time_cap_height = (readout_disc_radius * 10 // 21) // 2 * 2
+    date_cap_height = readout_disc_radius * 3 // 11
+    date_text_gap = readout_disc_radius * 4 // 50
+    stroke_width = 2
+
+    # usqrt() returns the root with 16 fractional bits, which the watch
+    # then scales down to fixed point.
+    r = readout_disc_radius - stroke_width // 2
+    battery_x = [isqrt((r * r - (r - k) * (r - k)) << 32) // (TRIG_MAX_RATIO // FIXED_POINT_SCALE)
+                 for k in range(BATTERY_STEPS)]
+
+    return {
+        'width': width,
+        'height': height,
+        'sunDiscRadius': sun_disc_radius * FIXED_POINT_SCALE,
+        'hourPipRadius': sun_disc_radius * FIXED_POINT_SCALE // 4,
+        'sunOrbitRadius': sun_orbit_radius * FIXED_POINT_SCALE,
+        'readoutDiscRadius': readout_disc_radius * FIXED_POINT_SCALE,
+        'dateTextGap': date_text_gap * FIXED_POINT_SCALE,
+        'strokeWidth': stroke_width * FIXED_POINT_SCALE,
+        'hourCapHeight': hour_cap_height,
+        'timeCapHeight': time_cap_height,
+        'dateCapHeight': date_cap_height,
+        'battery_x': battery_x,
+    }
+
+
+def hour_units():
+    """Unit vectors to each hour on the dial, as clock_point() computes
+    them: clockwise from midnight at the bottom, scaled by TRIG_MAX_RATIO."""
+    units = []
+    for h in range(HOURS):
+        angle = 2 * math.pi * h / HOURS
+        units.append((int(round(-math.sin(angle) * TRIG_MAX_RATIO)),
+                      int(round(math.cos(angle) * TRIG_MAX_RATIO))))
+    return units
+
+
+def write_header(out, platform, layout):
+    out.write('/* Generated by tools/layout-tables.py for {}.  Do not edit. */\n\n'.format(platform))
+    out.write('#pragma once\n\n')
+    out.write('static const Layout kFullLayout = {\n')
+    out.write('    .size = {{ {}, {} }},\n'.format(layout['width'], layout['height']))
+    for name in ('sunDiscRadius', 'hourPipRadius', 'sunOrbitRadius', 'readoutDiscRadius',
+                 'dateTextGap', 'strokeWidth', 'hourCapHeight', 'timeCapHeight', 'dateCapHeight'):
+        out.write('    .{} = {},\n'.format(name, layout[name]))
+    out.write('    .battery_x = {{ {} }},\n'.format(', '.join(str(x) for x in layout['battery_x'])))
+    out.write('};\n\n')
+    out.write('static const int32_t kHourUnit[{}][2] = {{\n'.format(HOURS))
+    for x, y in hour_units():
+        out.write('    {{ {}, {} }},\n'.format(x, y))
+    out.write('};\n')
+
+
+def main(argv):
+    if len(argv) != 3 or argv[1] not in PLATFORMS:
+        print('usage: layout-tables.py {} output.h'.format('|'.join(sorted(PLATFORMS))), file=sys.stderr)
+        return 1
+    platform = argv[1]
+    layout = compute_layout(*PLATFORMS[platform])
+    with open(argv[2], 'w') as out:
+        write_header(out, platform, layout)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
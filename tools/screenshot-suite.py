@@ -0,0 +1,306 @@
+#!/usr/bin/env python
+#
+# Render every SCREENSHOT scene on every platform, compare each frame
+# with its golden image, and record how long the frames took.
+#
+# usage: screenshot-suite.py [--host] [--update] [--platform P ...]
+#                            [--scene N ...] [--tolerance T]
+#
+# By default each scene is built with `pebble build` and run in the SDK
+# emulator.  The frame times come from the face's "screenshot N frame M"
+# log lines, and the frame from `pebble screenshot` once the face has
+# settled.  With --host, the binaries of tools/host render the scenes
+# instead.  That is faster and needs no emulator, but system font text
+# is not drawn, so host and emulator frames have separate goldens.
+#
+# Goldens:  test/golden/<emulator|host>/<platform>/scene<n>.png
+# Output:   build/screenshots/<emulator|host>/<platform>/scene<n>.png,
+#           a scene<n>-diff.png next to every mismatch, and timings.csv
+#
+# A pixel matches if some pixel of the golden image within one pixel of
+# it is within --tolerance in every channel, so that antialiasing that
+# moves by a pixel does not fail the suite.  --update records the
+# current frames as the new goldens.  None are checked in, so run with
+# --update once, before the change to be checked, to record them.
+#
+
+from __future__ import division, print_function
+
+import argparse
+import csv
+import os
+import re
+import struct
+import subprocess
+import sys
+import threading
+import time
+import zlib
+
+ROOT = os.path.abspath(os.path.join(os.path.dirname(__file__), '..'))
+PLATFORMS = ['aplite', 'basalt', 'chalk', 'diorite', 'emery']
+SCENES = [1, 2, 3, 4]
+SETTLE_SECONDS = 3
+TIMEOUT_SECONDS = 60
+HOST_FRAMES = 100
+
+FRAME_LOG = re.compile(r'screenshot (\d+) frame (\d+): (\d+) ms')
+HOST_FRAME = re.compile(r'frame: ([\d.]+) ms \(min ([\d.]+), max ([\d.]+)\) over (\d+) frames')
+
+
+# --------------------------------------------------------------------------
+# PNG
+# --------------------------------------------------------------------------
+
+def paeth(a, b, c):
+    p = a + b - c
+    pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+    if pa <= pb and pa <= pc:
+        return a
+    return b if pb <= pc else c
+
+
+def read_png(path):
+    """Decode an 8-bit gray, RGB, RGBA or palette PNG to rows of RGB
+    tuples."""
+    with open(path, 'rb') as f:
+        data = f.read()
+    if data[:8] != b'\x89PNG\r\n\x1a\n':
+        raise ValueError('{}: not a PNG file'.format(path))
+    pos = 8
+    idat = []
+    palette = None
+    while pos < len(data):
+        length, kind = struct.unpack('>I4s', data[pos:pos + 8])
+        body = data[pos + 8:pos + 8 + length]
+        pos += 12 + length
+        if kind == b'IHDR':
+            width, height, depth, color, _, _, interlace = struct.unpack('>IIBBBBB', body)
+        elif kind == b'PLTE':
+            palette = [tuple(bytearray(body[k:k + 3])) for k in range(0, len(body), 3)]
+        elif kind == b'IDAT':
+            idat.append(body)
+        elif kind == b'IEND':
+            break
+    channels = {0: 1, 2: 3, 3: 1, 4: 2, 6: 4}[color]
+    if depth != 8 or interlace:
+        raise ValueError('{}: only 8-bit, non-interlaced PNG files are supported'.format(path))
+
+    raw = bytearray(zlib.decompress(b''.join(idat)))
+    stride = width * channels
+    rows = []
+    prior = bytearray(stride)
+    for y in range(height):
+        start = y * (stride + 1)
+        kind = raw[start]
+        line = raw[start + 1:start + 1 + stride]
+        for x in range(stride):
+            a = line[x - channels] if x >= channels else 0
+            b = prior[x]
+            c = prior[x - channels] if x >= channels else 0
+            if kind == 1:
+                line[x] = (line[x] + a) & 0xff
+            elif kind == 2:
+                line[x] = (line[x] + b) & 0xff
+            elif kind == 3:
+                line[x] = (line[x] + (a + b) // 2) & 0xff
+            elif kind == 4:
+                line[x] = (line[x] + paeth(a, b, c)) & 0xff
+        prior = line
+        if color == 3:
+            rows.append([palette[v] for v in line])
+        elif color in (0, 4):
+            rows.append([(v, v, v) for v in line[::channels]])
+        else:
+            rows.append([tuple(line[x:x + 3]) for x in range(0, stride, channels)])
+    return rows
+
+
+def write_png(path, rows):
+    height = len(rows)
+    width = len(rows[0]) if rows else 0
+    raw = bytearray()
+    for row in rows:
+        raw.append(0)
+        for pixel in row:
+            raw.extend(pixel)
+
+    def chunk(kind, body):
+        return (struct.pack('>I', len(body)) + kind + body +
+                struct.pack('>I', zlib.crc32(kind + body) & 0xffffffff))
+
+    with open(path, 'wb') as f:
+        f.write(b'\x89PNG\r\n\x1a\n')
+        f.write(chunk(b'IHDR', struct.pack('>IIBBBBB', width, height, 8, 2, 0, 0, 0)))
+        f.write(chunk(b'IDAT', zlib.compress(bytes(raw), 9)))
+        f.write(chunk(b'IEND', b''))
+
+
+# --------------------------------------------------------------------------
+# Comparison
+# --------------------------------------------------------------------------
+
+def compare(frame, golden, tolerance):
+    """Return the number of mismatched pixels and a diff image: the frame
+    dimmed, with the mismatches in red."""
+    if len(frame) != len(golden) or len(frame[0]) != len(golden[0]):
+        return -1, None
+    height, width = len(frame), len(frame[0])
+    bad = 0
+    diff = []
+    for y in range(height):
+        row = []
+        for x in range(width):
+            pixel = frame[y][x]
+            near = False
+            for gy in range(max(0, y - 1), min(height, y + 2)):
+                for gx in range(max(0, x - 1), min(width, x + 2)):
+                    other = golden[gy][gx]
+                    if all(abs(pixel[k] - other[k]) <= tolerance for k in range(3)):
+                        near = True
+                        break
+                if near:
+                    break
+            if near:
+                row.append(tuple(v // 3 for v in pixel))
+            else:
+                bad += 1
+                row.append((255, 0, 0))
+        diff.append(row)
+    return bad, diff
+
+
+# --------------------------------------------------------------------------
+# Rendering
+# --------------------------------------------------------------------------
+
+def run(args, **kwargs):
+    print('+ ' + ' '.join(args))
+    subprocess.check_call(args, cwd=ROOT, **kwargs)
+
+
+def render_emulator(platform, scene, path):
+    """Install the scene build in the emulator, wait for it to settle and
+    take a screenshot.  Returns the logged frame times."""
+    run(['pebble', 'install', '--emulator', platform])
+    logs = subprocess.Popen(['pebble', 'logs', '--emulator', platform], cwd=ROOT,
+                            stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                            universal_newlines=True)
+    frames = []
+    last = [time.time()]
+
+    def read():
+        for line in logs.stdout:
+            match = FRAME_LOG.search(line)
+            if match and int(match.group(1)) == scene:
+                frames.append(int(match.group(3)))
+                last[0] = time.time()
+
+    reader = threading.Thread(target=read)
+    reader.daemon = True
+    reader.start()
+    start = time.time()
+    while (not frames or time.time() - last[0] < SETTLE_SECONDS) and time.time() - start < TIMEOUT_SECONDS:
+        time.sleep(0.2)
+    try:
+        if not frames:
+            raise RuntimeError('{} scene {}: no frames logged'.format(platform, scene))
+        run(['pebble', 'screenshot', '--emulator', platform, '--no-open', path])
+    finally:
+        logs.terminate()
+    return frames
+
+
+def build_emulator(scene):
+    env = dict(os.environ)
+    env['HORIZON_DEFINES'] = 'SCREENSHOT={}'.format(scene)
+    run(['pebble', 'build'], env=env)
+
+
+def render_host(platform, scene, path):
+    """Render the scene with the host build.  Returns the mean frame time,
+    as the host has no first frame worth timing on its own."""
+    run(['make', '-s', '-C', 'tools/host', 'all'])
+    binary = os.path.join(ROOT, 'build', 'host', platform, 'render-{}'.format(scene))
+    output = subprocess.check_output(
+        [binary, '-q', '-r', os.path.join(ROOT, 'resources', 'data'),
+         '-n', str(HOST_FRAMES), '-o', path], universal_newlines=True)
+    match = HOST_FRAME.search(output)
+    return [float(match.group(1))] if match else []
+
+
+# --------------------------------------------------------------------------
+# main
+# --------------------------------------------------------------------------
+
+def main(argv):
+    parser = argparse.ArgumentParser(description='Render and compare the screenshot scenes.')
+    parser.add_argument('--host', action='store_true', help='render with tools/host instead of the emulator')
+    parser.add_argument('--update', action='store_true', help='record the frames as the new goldens')
+    parser.add_argument('--platform', action='append', choices=PLATFORMS, help='platform to render, repeatable')
+    parser.add_argument('--scene', action='append', type=int, choices=SCENES, help='scene to render, repeatable')
+    parser.add_argument('--tolerance', type=int, default=16, help='per channel difference allowed, 0 to 255')
+    options = parser.parse_args(argv[1:])
+
+    mode = 'host' if options.host else 'emulator'
+    platforms = options.platform or PLATFORMS
+    scenes = options.scene or SCENES
+    golden_dir = os.path.join(ROOT, 'test', 'golden', mode)
+    out_dir = os.path.join(ROOT, 'build', 'screenshots', mode)
+
+    timings = []
+    failures = []
+    for scene in scenes:
+        if not options.host:
+            build_emulator(scene)
+        for platform in platforms:
+            name = 'scene{}'.format(scene)
+            frame_path = os.path.join(out_dir, platform, name + '.png')
+            golden_path = os.path.join(golden_dir, platform, name + '.png')
+            directories = [os.path.dirname(frame_path)]
+            if options.update:
+                directories.append(os.path.dirname(golden_path))
+            for directory in directories:
+                if not os.path.isdir(directory):
+                    os.makedirs(directory)
+
+            if options.host:
+                frames = render_host(platform, scene, frame_path)
+            else:
+                frames = render_emulator(platform, scene, frame_path)
+            first = frames[0] if frames else ''
+            mean = sum(frames) / len(frames) if frames else ''
+            timings.append([mode, platform, scene, len(frames), first, mean])
+
+            frame = read_png(frame_path)
+            if options.update:
+                write_png(golden_path, frame)
+                print('{} {}: recorded'.format(platform, name))
+                continue
+            if not os.path.exists(golden_path):
+                failures.append('{} {}: no golden, record one with --update'.format(platform, name))
+                continue
+            bad, diff = compare(frame, read_png(golden_path), options.tolerance)
+            if bad < 0:
+                failures.append('{} {}: size differs from the golden'.format(platform, name))
+            elif bad > 0:
+                diff_path = os.path.join(out_dir, platform, name + '-diff.png')
+                write_png(diff_path, diff)
+                failures.append('{} {}: {} pixels differ, see {}'.format(platform, name, bad, diff_path))
+            else:
+                print('{} {}: ok'.format(platform, name))
+
+    with open(os.path.join(out_dir, 'timings.csv'), 'w') as f:
+        writer = csv.writer(f)
+        writer.writerow(['mode', 'platform', 'scene', 'frames', 'first_ms', 'mean_ms'])
+        writer.writerows(timings)
+    for row in timings:
+        print('{1} scene {2}: {3} frames, first {4} ms, mean {5} ms'.format(*row))
+
+    for failure in failures:
+        print(failure, file=sys.stderr)
+    return 1 if failures else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))